@@ -173,6 +173,9 @@ FL_EXPORT int fl_utf_strncasecmp(const char *s1, const char *s2, int n);
 /* OD: UTF-8 aware strcasecmp - converts to Unicode and tests */
 FL_EXPORT int fl_utf_strcasecmp(const char *s1, const char *s2);
 
+/* make a key for sorting with strcmp() in the order of fl_utf_strcasecmp() */
+FL_EXPORT unsigned fl_utf_sortkey(const char *src, char *dst, unsigned dstlen);
+
 /* OD: return the Unicode lower case value of ucs */
 FL_EXPORT int fl_tolower(unsigned int ucs);
 
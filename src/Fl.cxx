@@ -767,6 +767,11 @@ void Fl::redraw() {
   for (Fl_X* i = Fl_X::first; i; i = i->next) i->w->redraw();
 }
 
+extern int fl_profiling; // in Fl_Profiler.cxx
+extern void fl_profile_frame(int begin);
+extern void fl_profile_begin(Fl_Widget*);
+extern void fl_profile_end(Fl_Widget*);
+
 /**
   Causes all the windows that need it to be redrawn and graphics forced
   out through the pipes.
@@ -781,14 +786,21 @@ void Fl::redraw() {
 void Fl::flush() {
   if (damage()) {
     damage_ = 0;
+    if (fl_profiling) fl_profile_frame(1);
     for (Fl_X* i = Fl_X::first; i; i = i->next) {
       if (i->wait_for_expose) {damage_ = 1; continue;}
       Fl_Window* wi = i->w;
       if (!wi->visible_r()) continue;
-      if (wi->damage()) {i->flush(); wi->clear_damage();}
+      if (wi->damage()) {
+        if (fl_profiling) fl_profile_begin(wi);
+        i->flush();
+        if (fl_profiling) fl_profile_end(wi);
+        wi->clear_damage();
+      }
       // destroy damage regions for windows that don't use them:
       if (i->region) {XDestroyRegion(i->region); i->region = 0;}
     }
+    if (fl_profiling) fl_profile_frame(0);
   }
 #if defined(USE_X11)
   if (fl_display) XFlush(fl_display);
@@ -1838,11 +1850,18 @@ void Fl_Widget::damage(uchar fl) {
   }
 }
 
+extern int fl_group_cache_damaged(Fl_Group*, Fl_Widget*); // in Fl_Group.cxx
+
 void Fl_Widget::damage(uchar fl, int X, int Y, int W, int H) {
   Fl_Widget* wi = this;
   // mark all parent widgets between this and window with FL_DAMAGE_CHILD:
   while (wi->type() < FL_WINDOW) {
     wi->damage_ |= fl;
+    if ((wi->flags() & CACHE_MODE) &&
+        fl_group_cache_damaged((Fl_Group*)wi, this)) return;
+    // a hidden widget is redrawn completely when it is shown again, so
+    // there is no need to redraw the area of the window it covers:
+    if (!wi->visible()) return;
     wi = wi->parent();
     if (!wi) return;
     fl = FL_DAMAGE_CHILD;
@@ -1867,6 +1886,12 @@ void Fl_Widget::damage(uchar fl, int X, int Y, int W, int H) {
     // if we already have damage we must merge with existing region:
     if (i->region) {
 #if defined(USE_X11)
+      // widgets that are redrawn several times before the next flush
+      // usually add the same area again:
+      if (XRectInRegion(i->region, X, Y, W, H) == RectangleIn) {
+        wi->damage_ |= fl;
+        return;
+      }
       XRectangle R;
       R.x = X; R.y = Y; R.width = W; R.height = H;
       XUnionRectWithRegion(&R, i->region, i->region);
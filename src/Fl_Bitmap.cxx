@@ -346,11 +346,14 @@ void Fl_GDI_Printer_Graphics_Driver::draw(Fl_Bitmap *bm, int XP, int YP, int WP,
 }  
 
 #else // Xlib
+void fl_sync_gc(); // from fl_rect.cxx
+
 void Fl_Xlib_Graphics_Driver::draw(Fl_Bitmap *bm, int XP, int YP, int WP, int HP, int cx, int cy) {
   int X, Y, W, H;
   if (bm->start(XP, YP, WP, HP, cx, cy, X, Y, W, H)) {
     return;
   }
+  fl_sync_gc();
   
   XSetStipple(fl_display, fl_gc, bm->id_);
   int ox = X-cx; if (ox < 0) ox += bm->w();
@@ -26,6 +26,10 @@
 #include <FL/Fl_Printer.H>
 #include <FL/x.H>
 #include <FL/fl_draw.H>
+#include "flstring.h"
+#ifndef WIN32
+#  include <sys/time.h>
+#endif
 
 // On systems that support double buffering "naturally" the base
 // Fl_Window class will probably do double-buffer and this subclass
@@ -57,8 +61,136 @@ static int can_xdbe() {
   }
   return use_xdbe;
 }
+
+// Returns non-zero if back buffers are Xdbe buffers, see fl_scroll():
+int fl_xdbe_in_use() {
+  return use_xdbe;
+}
+#endif
+
+
+////////////////////////////////////////////////////////////////
+// Per-window state that doesn't fit into Fl_X or the class: the size of
+// the back buffer pixmap and the frame timing.
+
+struct Fl_Double_Window_Info {
+  Fl_Double_Window *window;
+  Fl_Double_Window_Info *next;
+  int buffer_w, buffer_h;	// size of the back buffer pixmap
+  double last_frame;		// frame_clock() when the last frame started
+  uchar damage;			// damage() of the window while a frame is delayed
+  char waiting;			// frame_timeout() is pending
+};
+
+static Fl_Double_Window_Info *first_info = 0;
+
+static Fl_Double_Window_Info *window_info(const Fl_Double_Window *w, int create) {
+  for (Fl_Double_Window_Info *i = first_info; i; i = i->next)
+    if (i->window == w) return i;
+  if (!create) return 0;
+  Fl_Double_Window_Info *i = new Fl_Double_Window_Info;
+  memset(i, 0, sizeof(*i));
+  i->window = (Fl_Double_Window *)w;
+  i->last_frame = -1.0;
+  i->next = first_info;
+  first_info = i;
+  return i;
+}
+
+static void frame_timeout(void *);
+
+static void delete_window_info(const Fl_Double_Window *w) {
+  for (Fl_Double_Window_Info **p = &first_info; *p; p = &(*p)->next) {
+    Fl_Double_Window_Info *i = *p;
+    if (i->window != w) continue;
+    if (i->waiting) Fl::remove_timeout(frame_timeout, i);
+    *p = i->next;
+    delete i;
+    return;
+  }
+}
+
+static double frame_interval = 0.0;		// see Fl_Double_Window::frame_rate()
+static Fl_Frame_Handler frame_handler_ = 0;	// see Fl_Double_Window::frame_handler()
+static void *frame_handler_data = 0;
+
+// Returns the time in seconds, for frame timing:
+static double frame_clock() {
+#ifdef WIN32
+  LARGE_INTEGER f, c;
+  QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&c);
+  return (double)c.QuadPart / (double)f.QuadPart;
+#else
+  struct timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec + t.tv_usec / 1000000.0;
 #endif
+}
+
+// Damages the window again when a delayed frame is due:
+static void frame_timeout(void *v) {
+  Fl_Double_Window_Info *i = (Fl_Double_Window_Info *)v;
+  i->waiting = 0;
+  Fl_Double_Window *w = i->window;
+  Fl_X *myi = Fl_X::i(w);
+  if (!myi) return;
+  if (myi->region) {XDestroyRegion(myi->region); myi->region = 0;}
+  // without a region, FL_DAMAGE_EXPOSE would redraw everything:
+  uchar d = w->damage() | i->damage;
+  if (d & ~FL_DAMAGE_EXPOSE) d &= ~FL_DAMAGE_EXPOSE;
+  i->damage = 0;
+  w->clear_damage(d);
+  Fl::damage(FL_DAMAGE_CHILD);
+}
+
+/**
+  Sets the maximum number of frames per second drawn by double-buffered
+  windows.
+
+  Animations that redraw a window more often than the display refreshes
+  spend most of their time drawing frames that are never seen. With a
+  frame rate, for instance the refresh rate of the monitor, flush()
+  draws a window at most once per frame interval and delays the damage
+  to a timeout at the start of the next interval. Damage that arrives in
+  the meantime is drawn with the same frame.
+
+  There is no portable way to wait for the vertical retrace, so the
+  frames are paced by a timer. Fl_Overlay_Window is not paced.
+
+  \param[in] fps frames per second, 0 (the default) draws immediately
+  \see frame_rate(), frame_handler()
+*/
+void Fl_Double_Window::frame_rate(double fps) {
+  frame_interval = fps > 0.0 ? 1.0 / fps : 0.0;
+}
+
+/**
+  Returns the maximum number of frames per second, 0 if frames are drawn
+  immediately.
+  \see frame_rate(double)
+*/
+double Fl_Double_Window::frame_rate() {
+  return frame_interval > 0.0 ? 1.0 / frame_interval : 0.0;
+}
 
+/**
+  Sets a function that is called after each frame of a double-buffered
+  window, for instance to display or log frame times.
+
+  The function gets the window, the time in seconds that flush() needed
+  to draw and copy the frame, and the time in seconds since the start of
+  the previous frame of the window (0 for the first frame). The times are
+  measured in the program, the time the window system needs to execute
+  the drawing requests is not included.
+
+  \param[in] h the function, NULL to not call a function
+  \param[in] data passed to the function
+*/
+void Fl_Double_Window::frame_handler(Fl_Frame_Handler h, void *data) {
+  frame_handler_ = h;
+  frame_handler_data = data;
+}
 
 Fl_Double_Window::Fl_Double_Window(int W, int H, const char *l) 
 : Fl_Window(W,H,l), 
@@ -133,13 +265,17 @@ void Fl_Graphics_Driver::copy_offscreen(int x, int y, int w, int h, Fl_Offscreen
 #include <X11/extensions/Xrender.h>
 #endif
 
+void fl_sync_gc(); // from fl_rect.cxx
+
 void Fl_Xlib_Graphics_Driver::copy_offscreen(int x, int y, int w, int h, Fl_Offscreen pixmap, int srcx, int srcy) {
+  fl_sync_gc();
   XCopyArea(fl_display, pixmap, fl_window, fl_gc, srcx, srcy, w, h, x, y);
 }
 
 void Fl_Xlib_Graphics_Driver::copy_offscreen_with_alpha(int x, int y, int w, int h,
 						        Fl_Offscreen pixmap, int srcx, int srcy) {
 #if HAVE_XRENDER
+  fl_sync_gc();
   XRenderPictureAttributes srcattr;
   memset(&srcattr, 0, sizeof(XRenderPictureAttributes));
   static XRenderPictFormat *srcfmt = XRenderFindStandardFormat(fl_display, PictStandardARGB32);
@@ -385,7 +521,34 @@ void fl_end_offscreen() {
 /**
   Forces the window to be redrawn.
 */
-void Fl_Double_Window::flush() {flush(0);}
+// Records the start of a frame and calls the frame handler:
+static void frame_done(Fl_Double_Window_Info *i, double start) {
+  if (!i) return;
+  double interval = i->last_frame >= 0.0 ? start - i->last_frame : 0.0;
+  i->last_frame = start;
+  if (frame_handler_)
+    frame_handler_(i->window, frame_clock() - start, interval, frame_handler_data);
+}
+
+void Fl_Double_Window::flush() {
+  if (frame_interval > 0.0) {
+    Fl_Double_Window_Info *i = window_info(this, 1);
+    double wait = i->last_frame + frame_interval - frame_clock();
+    if (i->waiting || (i->last_frame >= 0.0 && wait > 0.001)) {
+      // Delay the frame. The damage region is dropped, so the damaged
+      // widgets are drawn completely and the entire window is copied:
+      Fl_X *myi = Fl_X::i(this);
+      if (myi && myi->region) {XDestroyRegion(myi->region); myi->region = 0;}
+      i->damage |= damage();
+      if (!i->waiting) {
+        i->waiting = 1;
+        Fl::add_timeout(wait, frame_timeout, i);
+      }
+      return;
+    }
+  }
+  flush(0);
+}
 
 /**
   Forces the window to be redrawn.
@@ -400,6 +563,14 @@ void Fl_Double_Window::flush(int eraseoverlay) {
   make_current(); // make sure fl_gc is non-zero
   Fl_X *myi = Fl_X::i(this);
   if (!myi) return; // window not yet created
+
+  double start = 0.0;
+  Fl_Double_Window_Info *info = 0;
+  if (frame_interval > 0.0 || frame_handler_) {
+    start = frame_clock();
+    info = window_info(this, 1);
+  }
+
   if (!myi->other_xid) {
 #if USE_XDBE
     if (can_xdbe()) {
@@ -408,8 +579,21 @@ void Fl_Double_Window::flush(int eraseoverlay) {
     } else
 #endif
 #if defined(USE_X11) || defined(WIN32)
-    myi->other_xid = fl_create_offscreen(w(), h());
-    clear_damage(FL_DAMAGE_ALL);
+    {
+      // The pixmap is kept while the window shrinks, and it grows by
+      // at least 50% so that resizing doesn't allocate a new pixmap
+      // for every step:
+      Fl_Double_Window_Info *i = window_info(this, 1);
+      int W = w(), H = h();
+      if (i->buffer_w && W > i->buffer_w && W < i->buffer_w * 3 / 2)
+        W = i->buffer_w * 3 / 2;
+      if (i->buffer_h && H > i->buffer_h && H < i->buffer_h * 3 / 2)
+        H = i->buffer_h * 3 / 2;
+      myi->other_xid = fl_create_offscreen(W, H);
+      i->buffer_w = W;
+      i->buffer_h = H;
+      clear_damage(FL_DAMAGE_ALL);
+    }
 #elif defined(__APPLE_QUARTZ__)
     if (force_doublebuffering_) {
       myi->other_xid = fl_create_offscreen(w(), h());
@@ -428,24 +612,35 @@ void Fl_Double_Window::flush(int eraseoverlay) {
       myi->backbuffer_bad = 0;
     }
 
-    // Redraw as needed...
-    if (damage()) {
-      fl_clip_region(myi->region); myi->region = 0;
+    // The back buffer keeps its contents (XdbeCopied), so exposed areas
+    // are only copied again. Redraw as needed...
+    int all = (damage() & FL_DAMAGE_ALL) && !myi->region;
+    fl_clip_region(myi->region); myi->region = 0;
+    if (damage() & ~FL_DAMAGE_EXPOSE) {
       fl_window = myi->other_xid;
       draw();
       fl_window = myi->xid;
     }
 
-    // Copy contents of back buffer to window...
-    XdbeSwapInfo s;
-    s.swap_window = fl_xid(this);
-    s.swap_action = XdbeCopied;
-    XdbeSwapBuffers(fl_display, &s, 1);
+    if (all) {
+      // Swap the entire window...
+      XdbeSwapInfo s;
+      s.swap_window = fl_xid(this);
+      s.swap_action = XdbeCopied;
+      XdbeSwapBuffers(fl_display, &s, 1);
+    } else {
+      // Copy the damaged area of the back buffer to the window...
+      int X,Y,W,H; fl_clip_box(0,0,w(),h(),X,Y,W,H);
+      fl_copy_offscreen(X, Y, W, H, myi->other_xid, X, Y);
+    }
+    frame_done(info, start);
     return;
-  } else
+  }
 #endif
+  // The pixmap keeps its contents, so exposed areas are only copied
+  // again, and only the damaged area is copied:
+  fl_clip_region(myi->region); myi->region = 0;
   if (damage() & ~FL_DAMAGE_EXPOSE) {
-    fl_clip_region(myi->region); myi->region = 0;
 #ifdef WIN32
     HDC _sgc = fl_gc;
     fl_gc = fl_makeDC(myi->other_xid);
@@ -478,6 +673,7 @@ void Fl_Double_Window::flush(int eraseoverlay) {
   // the current clip region:
   int X,Y,W,H; fl_clip_box(0,0,w(),h(),X,Y,W,H);
   if (myi->other_xid) fl_copy_offscreen(X, Y, W, H, myi->other_xid, X, Y);
+  frame_done(info, start);
 }
 
 void Fl_Double_Window::resize(int X,int Y,int W,int H) {
@@ -496,10 +692,17 @@ void Fl_Double_Window::resize(int X,int Y,int W,int H) {
   }
 #endif
   Fl_X* myi = Fl_X::i(this);
-  if (myi && myi->other_xid && (ow != w() || oh != h())) {
-    fl_delete_offscreen(myi->other_xid);
-    myi->other_xid = 0;
-  }
+  if (!myi || !myi->other_xid || (ow == w() && oh == h())) return;
+#if defined(USE_X11) || defined(WIN32)
+  // keep the pixmap unless it is too small or much too large:
+  Fl_Double_Window_Info *i = window_info(this, 0);
+  if (i && w() <= i->buffer_w && h() <= i->buffer_h &&
+      4.0 * w() * h() >= (double)i->buffer_w * i->buffer_h) return;
+  if (i && 4.0 * w() * h() < (double)i->buffer_w * i->buffer_h)
+    i->buffer_w = i->buffer_h = 0; // allocate the exact size
+#endif
+  fl_delete_offscreen(myi->other_xid);
+  myi->other_xid = 0;
 }
 
 void Fl_Double_Window::hide() {
@@ -513,6 +716,7 @@ void Fl_Double_Window::hide() {
 #endif
       fl_delete_offscreen(myi->other_xid);
   }
+  delete_window_info(this);
   Fl_Window::hide();
 }
 
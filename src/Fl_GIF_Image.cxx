@@ -25,6 +25,7 @@
 
 #include <FL/Fl.H>
 #include <FL/Fl_GIF_Image.H>
+#include <FL/Fl_Widget.H>
 #include <stdio.h>
 #include <stdlib.h>
 #include <FL/fl_utf8.h>
@@ -67,245 +68,362 @@
 
 typedef unsigned char uchar;
 
-#define NEXTBYTE (uchar)getc(GifFile)
-#define GETSHORT(var) var = NEXTBYTE; var += NEXTBYTE << 8
 
-/**
- The constructor loads the named GIF image.
+//
+// GIF decoder working on the whole file in memory...
+//
+// The LZW decoder keeps the length and the first character of every
+// string in its table, so each code is written directly to its final
+// position in the index buffer instead of being reversed through a stack.
+//
 
- The destructor frees all memory and server resources that are used by
- the image.
+struct Fl_GIF_Reader {
+  const uchar	*p, *end;		// Current position and end of the data
+  const char	*name;			// File name for messages
+
+  int eof() const { return p >= end; }
+  uchar byte() { return p < end ? *p++ : 0; }
+  int word() { int v = byte(); return v + (byte() << 8); }
+  void skip_blocks() {			// Skip a sequence of data sub-blocks
+    int n;
+    while (p < end && (n = *p++) != 0) p += n;
+    if (p > end) p = end;
+  }
+};
 
- Use Fl_Image::fail() to check if Fl_GIF_Image failed to load. fail() returns
- ERR_FILE_ACCESS if the file could not be opened or read, ERR_FORMAT if the
- GIF format could not be decoded, and ERR_NO_IMAGE if the image could not
- be loaded for another reason.
- */
-Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
-  FILE *GifFile;	// File to read
-  char **new_data;	// Data array
+struct Fl_GIF_Frame {
+  int		x, y, w, h;		// Position and size of the frame
+  int		transparent;		// Transparent color index or -1
+  int		delay;			// Delay in 1/100 seconds
+  int		dispose;		// Disposal method (GIF89a)
+  uchar		palette[256 * 3];	// RGB color map
+  uchar		*pixels;		// Color indices, w * h
+};
 
-  if ((GifFile = fl_fopen(infname, "rb")) == NULL) {
-    Fl::error("Fl_GIF_Image: Unable to open %s!", infname);
-    ld(ERR_FILE_ACCESS);
-    return;
-  }
+struct Fl_GIF_Header {
+  int		w, h;			// Logical screen size
+  int		loop_count;		// Netscape loop count, 0 = forever, -1 = none
+  uchar		palette[256 * 3];	// Global color map
+};
 
-  {char b[6];
-  if (fread(b,1,6,GifFile)<6) {
-    fclose(GifFile);
-    ld(ERR_FILE_ACCESS);
-    return; /* quit on eof */
-  }
-  if (b[0]!='G' || b[1]!='I' || b[2] != 'F') {
-    fclose(GifFile);
-    Fl::error("Fl_GIF_Image: %s is not a GIF file.\n", infname);
-    ld(ERR_FORMAT);
-    return;
-  }
-  if (b[3]!='8' || b[4]>'9' || b[5]!= 'a')
-    Fl::warning("%s is version %c%c%c.",infname,b[3],b[4],b[5]);
+
+//
+// 'gif_decode_lzw()' - Decode the LZW data of a frame into npixels indices.
+//
+// Returns the number of decoded pixels; missing pixels are set to 0.
+//
+
+static int gif_decode_lzw(Fl_GIF_Reader &in, int min_code_size,
+                          uchar *out, int npixels) {
+  unsigned short	prefix[4096];	// Previous code of each string
+  uchar			suffix[4096];	// Last character of each string
+  uchar			first[4096];	// First character of each string
+  unsigned short	length[4096];	// Length of each string
+
+  if (min_code_size < 2 || min_code_size > 11) min_code_size = 8;
+
+  int clear_code = 1 << min_code_size;
+  int eoi_code   = clear_code + 1;
+  int code_size  = min_code_size + 1;
+  int code_mask  = (1 << code_size) - 1;
+  int next_code  = clear_code + 2;
+  int old_code   = -1;
+
+  for (int i = 0; i < clear_code; i ++) {
+    prefix[i] = 0;
+    suffix[i] = first[i] = (uchar)i;
+    length[i] = 1;
   }
 
-  int Width; GETSHORT(Width);
-  int Height; GETSHORT(Height);
-
-  uchar ch = NEXTBYTE;
-  char HasColormap = ((ch & 0x80) != 0);
-  int BitsPerPixel = (ch & 7) + 1;
-  int ColorMapSize = 1 << BitsPerPixel;
-  // int OriginalResolution = ((ch>>4)&7)+1;
-  // int SortedTable = (ch&8)!=0;
-  ch = NEXTBYTE; // Background Color index
-  ch = NEXTBYTE; // Aspect ratio is N/64
-
-  // Read in global colormap:
-  uchar transparent_pixel = 0;
-  char has_transparent = 0;
-  uchar Red[256], Green[256], Blue[256]; /* color map */
-  if (HasColormap) {
-    for (int i=0; i < ColorMapSize; i++) {	
-      Red[i] = NEXTBYTE;
-      Green[i] = NEXTBYTE;
-      Blue[i] = NEXTBYTE;
+  unsigned	bits     = 0;		// Bit accumulator
+  int		nbits    = 0;		// Number of bits in the accumulator
+  int		blocklen = 0;		// Bytes left in the current sub-block
+  int		pos      = 0;		// Output position
+
+  while (pos < npixels) {
+    // Fetch the next code, the codes are packed LSB first into sub-blocks...
+    while (nbits < code_size) {
+      if (!blocklen) {
+        blocklen = in.byte();
+        if (!blocklen || in.eof()) goto done;
+      }
+      bits |= (unsigned)in.byte() << nbits;
+      nbits += 8;
+      blocklen --;
+    }
+
+    int code = (int)(bits & code_mask);
+    bits  >>= code_size;
+    nbits  -= code_size;
+
+    if (code == clear_code) {
+      code_size = min_code_size + 1;
+      code_mask = (1 << code_size) - 1;
+      next_code = clear_code + 2;
+      old_code  = -1;
+      continue;
+    }
+
+    if (code == eoi_code) break;
+
+    if (old_code < 0) {
+      // First code after a clear code is always a literal...
+      if (code >= clear_code) break;
+      out[pos ++] = (uchar)code;
+      old_code = code;
+      continue;
+    }
+
+    if (code > next_code || (code == next_code && next_code >= 4096)) {
+      Fl::error("Fl_GIF_Image: %s - LZW Barf!", in.name);
+      break;
+    }
+
+    if (next_code < 4096) {
+      // Add old string + first character of the new one...
+      prefix[next_code] = (unsigned short)old_code;
+      first[next_code]  = first[old_code];
+      suffix[next_code] = code == next_code ? first[old_code] : first[code];
+      length[next_code] = (unsigned short)(length[old_code] + 1);
+      next_code ++;
+
+      if (next_code > code_mask && code_size < 12) {
+        code_size ++;
+        code_mask = (1 << code_size) - 1;
+      }
+    }
+
+    // Write the string backwards from its last character...
+    int len = length[code];
+    int c   = code;
+
+    for (int i = len - 1; i >= 0; i --) {
+      if (pos + i < npixels) out[pos + i] = suffix[c];
+      c = prefix[c];
     }
+
+    pos += len;
+    old_code = code;
+  }
+
+done:
+  // Skip the rest of the current sub-block and any following ones...
+  in.p += blocklen;
+  if (in.p > in.end) in.p = in.end;
+  in.skip_blocks();
+
+  if (pos > npixels) pos = npixels;
+  if (pos < npixels) memset(out + pos, 0, npixels - pos);
+
+  return pos;
+}
+
+
+//
+// 'gif_read_header()' - Read the GIF header and global color map.
+//
+
+static int gif_read_header(Fl_GIF_Reader &in, Fl_GIF_Header &hdr) {
+  if (in.end - in.p < 13) return Fl_Image::ERR_FILE_ACCESS;
+
+  if (in.p[0] != 'G' || in.p[1] != 'I' || in.p[2] != 'F') {
+    Fl::error("Fl_GIF_Image: %s is not a GIF file.\n", in.name);
+    return Fl_Image::ERR_FORMAT;
+  }
+  if (in.p[3] != '8' || in.p[4] > '9' || in.p[5] != 'a')
+    Fl::warning("%s is version %c%c%c.", in.name, in.p[3], in.p[4], in.p[5]);
+  in.p += 6;
+
+  hdr.w = in.word();
+  hdr.h = in.word();
+  hdr.loop_count = -1;
+
+  uchar ch = in.byte();
+  int ColorMapSize = 1 << ((ch & 7) + 1);
+  in.byte(); // Background Color index
+  in.byte(); // Aspect ratio is N/64
+
+  memset(hdr.palette, 0, sizeof(hdr.palette));
+  if (ch & 0x80) {
+    for (int i = 0; i < 3 * ColorMapSize; i ++) hdr.palette[i] = in.byte();
   } else {
-    Fl::warning("%s does not have a colormap.", infname);
+    Fl::warning("%s does not have a colormap.", in.name);
     for (int i = 0; i < ColorMapSize; i++)
-      Red[i] = Green[i] = Blue[i] = (uchar)(255 * i / (ColorMapSize-1));
+      hdr.palette[3 * i] = hdr.palette[3 * i + 1] = hdr.palette[3 * i + 2] =
+        (uchar)(255 * i / (ColorMapSize-1));
   }
 
-  int CodeSize;		/* Code size, init from GIF header, increases... */
-  char Interlace;
+  return 0;
+}
 
-  for (;;) {
 
-    int i = NEXTBYTE;
-    if (i<0) {
-      fclose(GifFile);
-      Fl::error("Fl_GIF_Image: %s - unexpected EOF",infname); 
-      w(0); h(0); d(0); ld(ERR_FORMAT);
-      return;
-    }
-    int blocklen;
+//
+// 'gif_read_frame()' - Read and decode the next frame.
+//
+// Returns 1 if a frame was read, 0 at the end of the file, and -1 on errors.
+// The caller must delete[] frame.pixels.
+//
 
-    //  if (i == 0x3B) return 0;  eof code
+static int gif_read_frame(Fl_GIF_Reader &in, Fl_GIF_Header &hdr,
+                          Fl_GIF_Frame &frame) {
+  frame.transparent = -1;
+  frame.delay       = 0;
+  frame.dispose     = 0;
+  frame.pixels      = 0;
 
-    if (i == 0x21) {		// a "gif extension"
+  for (;;) {
+    if (in.eof()) return 0;		// Trailer is missing
+
+    int i = in.byte();
+
+    if (i == 0x3B) return 0;		// Trailer
+
+    if (i == 0x21) {			// a "gif extension"
+      uchar ch = in.byte();
+
+      if (ch == 0xF9 && in.p < in.end && *in.p == 4) { // Graphic control
+        in.byte();
+        uchar bits = in.byte();
+        frame.delay   = in.word();
+        frame.dispose = (bits >> 2) & 7;
+        uchar t = in.byte();
+        if (bits & 1) frame.transparent = t;
+      } else if (ch == 0xFF && in.end - in.p >= 15 &&
+                 !memcmp(in.p, "\013NETSCAPE2.0\003\001", 14)) {
+        in.p += 14;			// Netscape repeat count
+        hdr.loop_count = in.word();
+      } else if (ch != 0xFE && ch != 0xFF && ch != 0x01) { //Gif Comment
+        Fl::warning("%s: unknown gif extension 0x%02x.", in.name, ch);
+      }
 
-      ch = NEXTBYTE;
-      blocklen = NEXTBYTE;
+      in.skip_blocks();
+    } else if (i == 0x2c) {		// an image
+      frame.x = in.word();
+      frame.y = in.word();
+      frame.w = in.word();
+      frame.h = in.word();
+
+      uchar ch = in.byte();
+      int Interlace = ((ch & 0x40) != 0);
+
+      memcpy(frame.palette, hdr.palette, sizeof(frame.palette));
+      if (ch & 0x80) {
+        // read local color map
+        int n = 2<<(ch&7);
+        for (i = 0; i < 3 * n; i ++) frame.palette[i] = in.byte();
+      }
 
-      if (ch==0xF9 && blocklen==4) { // Netscape animation extension
+      int CodeSize = in.byte();
 
-	char bits;
-	bits = NEXTBYTE;
-	getc(GifFile); getc(GifFile); // GETSHORT(delay);
-	transparent_pixel = NEXTBYTE;
-	if (bits & 1) has_transparent = 1;
-	blocklen = NEXTBYTE;
+      if (frame.w <= 0 || frame.h <= 0 || in.eof()) {
+        Fl::error("Fl_GIF_Image: %s - unexpected EOF", in.name);
+        return -1;
+      }
 
-      } else if (ch == 0xFF) { // Netscape repeat count
-	;
+      int npixels = frame.w * frame.h;
+      frame.pixels = new uchar[npixels];
+      gif_decode_lzw(in, CodeSize, frame.pixels, npixels);
 
-      } else if (ch != 0xFE) { //Gif Comment
-	Fl::warning("%s: unknown gif extension 0x%02x.", infname, ch);
-      }
-    } else if (i == 0x2c) {	// an image
-
-      ch = NEXTBYTE; ch = NEXTBYTE; // GETSHORT(x_position);
-      ch = NEXTBYTE; ch = NEXTBYTE; // GETSHORT(y_position);
-      GETSHORT(Width);
-      GETSHORT(Height);
-      ch = NEXTBYTE;
-      Interlace = ((ch & 0x40) != 0);
-      if (ch&0x80) { 
-	// read local color map
-	int n = 2<<(ch&7);
-	for (i=0; i < n; i++) {	
-	  Red[i] = NEXTBYTE;
-	  Green[i] = NEXTBYTE;
-	  Blue[i] = NEXTBYTE;
-	}
+      if (Interlace) {
+        // Rows are stored in 4 passes: every 8th row from 0, every 8th
+        // from 4, every 4th from 2, and every 2nd from 1...
+        static const int start[4] = { 0, 4, 2, 1 };
+        static const int step[4]  = { 8, 8, 4, 2 };
+        uchar *rows = new uchar[npixels];
+        const uchar *src = frame.pixels;
+
+        for (int pass = 0; pass < 4; pass ++)
+          for (int y = start[pass]; y < frame.h; y += step[pass], src += frame.w)
+            memcpy(rows + y * frame.w, src, frame.w);
+
+        delete[] frame.pixels;
+        frame.pixels = rows;
       }
-      CodeSize = NEXTBYTE+1;
-      break; // okay, this is the image we want
+
+      return 1;
     } else {
-      Fl::warning("%s: unknown gif code 0x%02x", infname, i);
-      blocklen = 0;
+      Fl::warning("%s: unknown gif code 0x%02x", in.name, i);
     }
-
-    // skip the data:
-    while (blocklen>0) {while (blocklen--) {ch = NEXTBYTE;} blocklen=NEXTBYTE;}
   }
+}
+
+
+//
+// 'gif_read_file()' - Read a whole file into memory.
+//
+
+static uchar *gif_read_file(const char *name, long &size) {
+  FILE *fp = fl_fopen(name, "rb");
+
+  if (!fp) return 0;
 
-  if (BitsPerPixel >= CodeSize)
-  {
-    // Workaround for broken GIF files...
-    BitsPerPixel = CodeSize - 1;
-    ColorMapSize = 1 << BitsPerPixel;
+  uchar *buffer = 0;
+
+  if (!fseek(fp, 0, SEEK_END) && (size = ftell(fp)) > 0 && !fseek(fp, 0, SEEK_SET)) {
+    buffer = new uchar[size];
+    if (fread(buffer, 1, size, fp) != (size_t)size) {
+      delete[] buffer;
+      buffer = 0;
+    }
   }
 
-  uchar *Image = new uchar[Width*Height];
+  fclose(fp);
+  return buffer;
+}
 
-  int YC = 0, Pass = 0; /* Used to de-interlace the picture */
-  uchar *p = Image;
-  uchar *eol = p+Width;
 
-  int InitCodeSize = CodeSize;
-  int ClearCode = (1 << (CodeSize-1));
-  int EOFCode = ClearCode + 1;
-  int FirstFree = ClearCode + 2;
-  int FinChar = 0;
-  int ReadMask = (1<<CodeSize) - 1;
-  int FreeCode = FirstFree;
-  int OldCode = ClearCode;
+/**
+ The constructor loads the named GIF image.
 
-  // tables used by LZW decompresser:
-  short int Prefix[4096];
-  uchar Suffix[4096];
+ The destructor frees all memory and server resources that are used by
+ the image.
 
-  int blocklen = NEXTBYTE;
-  uchar thisbyte = NEXTBYTE; blocklen--;
-  int frombit = 0;
+ Use Fl_Image::fail() to check if Fl_GIF_Image failed to load. fail() returns
+ ERR_FILE_ACCESS if the file could not be opened or read, ERR_FORMAT if the
+ GIF format could not be decoded, and ERR_NO_IMAGE if the image could not
+ be loaded for another reason.
+ */
+Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
+  char **new_data;	// Data array
+  long size;		// Size of the file
+  uchar *buffer;	// File data
 
-  for (;;) {
+  if ((buffer = gif_read_file(infname, size)) == NULL) {
+    Fl::error("Fl_GIF_Image: Unable to open %s!", infname);
+    ld(ERR_FILE_ACCESS);
+    return;
+  }
 
-/* Fetch the next code from the raster data stream.  The codes can be
- * any length from 3 to 12 bits, packed into 8-bit bytes, so we have to
- * maintain our location as a pointer and a bit offset.
- * In addition, gif adds totally useless and annoying block counts
- * that must be correctly skipped over. */
-    int CurCode = thisbyte;
-    if (frombit+CodeSize > 7) {
-      if (blocklen <= 0) {
-	blocklen = NEXTBYTE;
-	if (blocklen <= 0) break;
-      }
-      thisbyte = NEXTBYTE; blocklen--;
-      CurCode |= thisbyte<<8;
-    }
-    if (frombit+CodeSize > 15) {
-      if (blocklen <= 0) {
-	blocklen = NEXTBYTE;
-	if (blocklen <= 0) break;
-      }
-      thisbyte = NEXTBYTE; blocklen--;
-      CurCode |= thisbyte<<16;
-    }
-    CurCode = (CurCode>>frombit)&ReadMask;
-    frombit = (frombit+CodeSize)%8;
-
-    if (CurCode == ClearCode) {
-      CodeSize = InitCodeSize;
-      ReadMask = (1<<CodeSize) - 1;
-      FreeCode = FirstFree;
-      OldCode = ClearCode;
-      continue;
-    }
+  Fl_GIF_Reader in;
+  Fl_GIF_Header hdr;
+  Fl_GIF_Frame frame;
 
-    if (CurCode == EOFCode) break;
-
-    uchar OutCode[1025]; // temporary array for reversing codes
-    uchar *tp = OutCode;
-    int i;
-    if (CurCode < FreeCode) i = CurCode;
-    else if (CurCode == FreeCode) {*tp++ = (uchar)FinChar; i = OldCode;}
-    else {Fl::error("Fl_GIF_Image: %s - LZW Barf!", infname); break;}
-
-    while (i >= ColorMapSize) {*tp++ = Suffix[i]; i = Prefix[i];}
-    *tp++ = FinChar = i;
-    do {
-      *p++ = *--tp;
-      if (p >= eol) {
-	if (!Interlace) YC++;
-	else switch (Pass) {
-	case 0: YC += 8; if (YC >= Height) {Pass++; YC = 4;} break;
-	case 1: YC += 8; if (YC >= Height) {Pass++; YC = 2;} break;
-	case 2: YC += 4; if (YC >= Height) {Pass++; YC = 1;} break;
-	case 3: YC += 2; break;
-	}
-	if (YC>=Height) YC=0; /* cheap bug fix when excess data */
-	p = Image + YC*Width;
-	eol = p+Width;
-      }
-    } while (tp > OutCode);
-
-    if (OldCode != ClearCode) {
-      Prefix[FreeCode] = (short)OldCode;
-      Suffix[FreeCode] = FinChar;
-      FreeCode++;
-      if (FreeCode > ReadMask) {
-	if (CodeSize < 12) {
-	  CodeSize++;
-	  ReadMask = (1 << CodeSize) - 1;
-	}
-	else FreeCode--;
-      }
-    }
-    OldCode = CurCode;
+  in.p    = buffer;
+  in.end  = buffer + size;
+  in.name = infname;
+
+  int err = gif_read_header(in, hdr);
+  if (err) {
+    delete[] buffer;
+    ld(err);
+    return;
+  }
+
+  if ((err = gif_read_frame(in, hdr, frame)) != 1) {
+    if (!err) Fl::error("Fl_GIF_Image: %s - unexpected EOF", infname);
+    delete[] buffer;
+    w(0); h(0); d(0); ld(ERR_FORMAT);
+    return;
   }
 
+  delete[] buffer;
+
+  int Width  = frame.w;
+  int Height = frame.h;
+  uchar *Image = frame.pixels;
+  uchar *Red = frame.palette;	// RGB triplets
+  uchar *p;
+
   // We are done reading the file, now convert to xpm:
 
   // allocate line pointer arrays:
@@ -315,55 +433,49 @@ Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
   new_data = new char*[Height+2];
 
   // transparent pixel must be zero, swap if it isn't:
-  if (has_transparent && transparent_pixel != 0) {
+  if (frame.transparent > 0) {
+    uchar transparent_pixel = (uchar)frame.transparent;
     // swap transparent pixel with zero
     p = Image+Width*Height;
     while (p-- > Image) {
       if (*p==transparent_pixel) *p = 0;
       else if (!*p) *p = transparent_pixel;
     }
-    uchar t;
-    t                        = Red[0];
-    Red[0]                   = Red[transparent_pixel];
-    Red[transparent_pixel]   = t;
-
-    t                        = Green[0];
-    Green[0]                 = Green[transparent_pixel];
-    Green[transparent_pixel] = t;
-
-    t                        = Blue[0];
-    Blue[0]                  = Blue[transparent_pixel];
-    Blue[transparent_pixel]  = t;
+    for (int c = 0; c < 3; c ++) {
+      uchar t                        = Red[c];
+      Red[c]                         = Red[3 * transparent_pixel + c];
+      Red[3 * transparent_pixel + c] = t;
+    }
   }
 
   // find out what colors are actually used:
   uchar used[256]; uchar remap[256];
   int i;
-  for (i = 0; i < ColorMapSize; i++) used[i] = 0;
+  for (i = 0; i < 256; i++) used[i] = 0;
   p = Image+Width*Height;
   while (p-- > Image) used[*p] = 1;
 
   // remap them to start with printing characters:
-  int base = has_transparent && used[0] ? ' ' : ' '+1;
+  int base = frame.transparent >= 0 && used[0] ? ' ' : ' '+1;
   int numcolors = 0;
-  for (i = 0; i < ColorMapSize; i++) if (used[i]) {
+  for (i = 0; i < 256; i++) if (used[i]) {
     remap[i] = (uchar)(base++);
     numcolors++;
   }
 
-  // write the first line of xpm data (use suffix as temp array):
-  int length = sprintf((char*)(Suffix),
-		       "%d %d %d %d",Width,Height,-numcolors,1);
+  // write the first line of xpm data:
+  char line[64];
+  int length = sprintf(line, "%d %d %d %d",Width,Height,-numcolors,1);
   new_data[0] = new char[length+1];
-  strcpy(new_data[0], (char*)Suffix);
+  strcpy(new_data[0], line);
 
   // write the colormap
   new_data[1] = (char*)(p = new uchar[4*numcolors]);
-  for (i = 0; i < ColorMapSize; i++) if (used[i]) {
+  for (i = 0; i < 256; i++) if (used[i]) {
     *p++ = remap[i];
-    *p++ = Red[i];
-    *p++ = Green[i];
-    *p++ = Blue[i];
+    *p++ = Red[3 * i];
+    *p++ = Red[3 * i + 1];
+    *p++ = Red[3 * i + 2];
   }
 
   // remap the image data:
@@ -381,11 +493,254 @@ Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
   alloc_data = 1;
 
   delete[] Image;
+}
+
+
+/**
+ The constructor loads all frames of the named GIF image.
+
+ Each frame is composited onto the logical screen of the GIF file
+ according to its position, transparency, and disposal method, and
+ stored as an RGBA image of the logical screen size. The image shows the
+ first frame until frame() is changed or the animation is start()ed.
+
+ Use Fl_Image::fail() to check if Fl_Anim_GIF_Image failed to load.
+
+ \param[in] filename	name of the GIF file
+ \param[in] canvas	widget to redraw when the shown frame changes, or NULL
+ */
+Fl_Anim_GIF_Image::Fl_Anim_GIF_Image(const char *filename, Fl_Widget *canvas)
+: Fl_RGB_Image(0,0,0) {
+  frames_      = 0;
+  frame_data_  = 0;
+  delays_      = 0;
+  frame_       = 0;
+  loop_count_  = -1;
+  loops_       = 0;
+  canvas_      = canvas;
+  playing_     = 0;
+  alloc_array  = 0;
+  array        = (uchar *)0;
+
+  long size;
+  uchar *buffer = gif_read_file(filename, size);
+
+  if (!buffer) {
+    Fl::error("Fl_GIF_Image: Unable to open %s!", filename);
+    ld(ERR_FILE_ACCESS);
+    return;
+  }
+
+  Fl_GIF_Reader in;
+  Fl_GIF_Header hdr;
+  Fl_GIF_Frame frame;
+
+  in.p    = buffer;
+  in.end  = buffer + size;
+  in.name = filename;
+
+  int err = gif_read_header(in, hdr);
+  if (err || hdr.w <= 0 || hdr.h <= 0) {
+    delete[] buffer;
+    ld(err ? err : ERR_FORMAT);
+    return;
+  }
+
+  int W = hdr.w, H = hdr.h;
+  size_t screen_size = (size_t)W * H * 4;
+  uchar *screen = new uchar[screen_size];	// Logical screen
+  uchar *previous = 0;				// Saved screen for disposal 3
+  int alloc_frames = 0;
+
+  memset(screen, 0, screen_size);
+
+  while (gif_read_frame(in, hdr, frame) == 1) {
+    if (frame.dispose == 3) {
+      if (!previous) previous = new uchar[screen_size];
+      memcpy(previous, screen, screen_size);
+    }
+
+    // Draw the frame onto the logical screen, frames may be partly or
+    // completely outside of it in broken files...
+    int x0 = frame.x, x1 = frame.x + frame.w;
+    int y0 = frame.y, y1 = frame.y + frame.h;
+    if (x0 < 0) x0 = 0; else if (x0 > W) x0 = W;
+    if (y0 < 0) y0 = 0; else if (y0 > H) y0 = H;
+    if (x1 > W) x1 = W;
+    if (y1 > H) y1 = H;
+    if (x0 >= x1 || y0 >= y1) x1 = x0 = y1 = y0 = 0;	// nothing visible
+
+    for (int y = y0; y < y1; y ++) {
+      const uchar *src = frame.pixels + (size_t)(y - frame.y) * frame.w + (x0 - frame.x);
+      uchar *dst = screen + ((size_t)y * W + x0) * 4;
+      for (int x = x0; x < x1; x ++, src ++, dst += 4) {
+        if (*src == frame.transparent) continue;
+        const uchar *rgb = frame.palette + 3 * *src;
+        dst[0] = rgb[0];
+        dst[1] = rgb[1];
+        dst[2] = rgb[2];
+        dst[3] = 255;
+      }
+    }
+
+    delete[] frame.pixels;
+
+    if (frames_ >= alloc_frames) {
+      alloc_frames = alloc_frames ? 2 * alloc_frames : 16;
+
+      uchar **temp_data   = new uchar *[alloc_frames];
+      double *temp_delays = new double[alloc_frames];
+      if (frames_) {
+        memcpy(temp_data, frame_data_, frames_ * sizeof(uchar *));
+        memcpy(temp_delays, delays_, frames_ * sizeof(double));
+      }
+      delete[] frame_data_;
+      delete[] delays_;
+      frame_data_ = temp_data;
+      delays_     = temp_delays;
+    }
+
+    frame_data_[frames_] = new uchar[screen_size];
+    memcpy(frame_data_[frames_], screen, screen_size);
+    delays_[frames_] = frame.delay / 100.0;
+    frames_ ++;
+
+    // Dispose of the frame before the next one is drawn...
+    if (frame.dispose == 2 && x0 < x1) {
+      for (int y = y0; y < y1; y ++)
+        memset(screen + ((size_t)y * W + x0) * 4, 0, (x1 - x0) * 4);
+    } else if (frame.dispose == 3) {
+      memcpy(screen, previous, screen_size);
+    }
+  }
+
+  delete[] previous;
+  delete[] screen;
+  delete[] buffer;
+
+  if (!frames_) {
+    Fl::error("Fl_GIF_Image: %s - unexpected EOF", filename);
+    ld(ERR_FORMAT);
+    return;
+  }
+
+  loop_count_ = hdr.loop_count;
+
+  w(W);
+  h(H);
+  d(4);
+  array = frame_data_[0];
+}
+
+
+/**
+ The destructor stops the animation and frees all frames.
+ */
+Fl_Anim_GIF_Image::~Fl_Anim_GIF_Image() {
+  stop();
+  for (int i = 0; i < frames_; i ++) delete[] frame_data_[i];
+  delete[] frame_data_;
+  delete[] delays_;
+  array = 0;
+}
+
+
+/**
+ Returns the delay of a frame in seconds.
+
+ This is the value stored in the GIF file, which is 0 for many files;
+ start() shows such frames for 0.1 seconds like most web browsers do.
+ */
+double Fl_Anim_GIF_Image::delay(int frame) const {
+  return (frame >= 0 && frame < frames_) ? delays_[frame] : 0.0;
+}
+
+
+/**
+ Returns the RGBA pixels of a frame.
+
+ Each frame is w() * h() * 4 bytes of composited image data.
+ */
+const uchar *Fl_Anim_GIF_Image::frame_data(int frame) const {
+  return (frame >= 0 && frame < frames_) ? frame_data_[frame] : 0;
+}
+
+
+/**
+ Shows another frame.
+
+ The cached image is released and the canvas() widget is redrawn.
+ */
+void Fl_Anim_GIF_Image::frame(int frame) {
+  if (frame < 0 || frame >= frames_ || frame == frame_) return;
+
+  frame_ = frame;
+  array  = frame_data_[frame];
+  uncache();
+
+  if (canvas_) canvas_->redraw();
+}
 
-  fclose(GifFile);
+
+/**
+ Starts the animation.
+
+ The frames are shown in turn with their delay() until stop() is called,
+ or until the loop count stored in the GIF file is reached.
+ */
+void Fl_Anim_GIF_Image::start() {
+  if (playing_ || frames_ < 2) return;
+
+  playing_ = 1;
+  loops_   = 0;
+  Fl::add_timeout(frame_delay_(frame_), animate_cb_, this);
+}
+
+
+/**
+ Stops the animation at the current frame.
+ */
+void Fl_Anim_GIF_Image::stop() {
+  if (!playing_) return;
+
+  playing_ = 0;
+  Fl::remove_timeout(animate_cb_, this);
+}
+
+
+//
+// 'Fl_Anim_GIF_Image::frame_delay_()' - Delay used to show a frame.
+//
+
+double Fl_Anim_GIF_Image::frame_delay_(int frame) const {
+  double d = delay(frame);
+  return d < 0.02 ? 0.1 : d;
 }
 
 
+//
+// 'Fl_Anim_GIF_Image::animate_cb_()' - Timeout callback showing the next frame.
+//
+
+void Fl_Anim_GIF_Image::animate_cb_(void *data) {
+  Fl_Anim_GIF_Image *img = (Fl_Anim_GIF_Image *)data;
+  int next = img->frame_ + 1;
+
+  if (next >= img->frames_) {
+    // Without a Netscape loop count the animation is shown once, a loop
+    // count of 0 repeats it forever, otherwise it is repeated that often...
+    next = 0;
+    img->loops_ ++;
+    if (img->loop_count_ && img->loops_ > img->loop_count_) {
+      img->playing_ = 0;
+      return;
+    }
+  }
+
+  img->frame(next);
+  Fl::repeat_timeout(img->frame_delay_(next), animate_cb_, data);
+}
+
 //
 // End of "$Id$".
 //
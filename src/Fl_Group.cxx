@@ -26,7 +26,10 @@
 #include <FL/Fl_Group.H>
 #include <FL/Fl_Window.H>
 #include <FL/fl_draw.H>
+#include <FL/Fl_Copy_Surface.H>
+#include <FL/math.h>
 #include <stdlib.h>
+#include "flstring.h"
 
 #include <FL/Fl_Input_Choice.H>
 #include <FL/Fl_Spinner.H>
@@ -144,6 +147,435 @@ static int navkey() {
   return 0;
 }
 
+////////////////////////////////////////////////////////////////
+// Spatial index, see Fl_Group::spatial_index(int)
+
+// The index is a uniform grid over the bounding box of the children.
+// Each cell has the ascending indices of the children that overlap it,
+// children that would be in too many cells are kept in a separate list.
+// The index is rebuilt on the next use after children were added,
+// removed, or resized.
+
+#define INDEX_MAX_SPAN 16	// children in more cells are in the "big" list
+
+struct Fl_Group_Index {
+  Fl_Group *group;
+  Fl_Group_Index *next;
+  int dirty;			// rebuild on the next use
+  int n;			// children() when it was built
+  int x0, y0, cell;		// grid origin and cell size
+  int cols, rows;
+  int *start;			// cols * rows + 1 offsets into items
+  int *items;			// child indices of all cells
+  int *big, nbig;		// children in too many cells
+  unsigned *stamp, stampno;	// to find each child only once
+  int *found, nfound;		// result of rect()
+
+  void build();
+  int point(int x, int y, int *out);
+  void rect(int x, int y, int w, int h);
+};
+
+static Fl_Group_Index *first_index = 0;
+
+static Fl_Group_Index *find_index(const Fl_Group *g) {
+  for (Fl_Group_Index *ix = first_index; ix; ix = ix->next)
+    if (ix->group == g) return ix;
+  return 0;
+}
+
+// Marks the index of a group as out of date. Called for the parent of
+// resized widgets (from Fl_Widget::resize()):
+void fl_group_index_changed(Fl_Group *g) {
+  Fl_Group_Index *ix = find_index(g);
+  if (ix) ix->dirty = 1;
+}
+
+void Fl_Group_Index::build() {
+  delete[] start; delete[] items; delete[] big; delete[] stamp; delete[] found;
+  start = items = big = found = 0;
+  stamp = 0;
+  nbig = nfound = 0;
+  stampno = 0;
+  dirty = 0;
+  n = group->children();
+  cols = rows = 0;
+  if (!n) return;
+
+  Fl_Widget*const* a = group->array();
+  stamp = new unsigned[n];
+  memset(stamp, 0, n * sizeof(unsigned));
+  found = new int[n];
+
+  // bounding box of all children:
+  int i, bx0 = 0, by0 = 0, bx1 = 0, by1 = 0, first = 1;
+  for (i = 0; i < n; i ++) {
+    Fl_Widget *o = a[i];
+    if (o->w() <= 0 || o->h() <= 0) continue;
+    if (first) {
+      bx0 = o->x(); by0 = o->y(); bx1 = o->x() + o->w(); by1 = o->y() + o->h();
+      first = 0;
+    } else {
+      if (o->x() < bx0) bx0 = o->x();
+      if (o->y() < by0) by0 = o->y();
+      if (o->x() + o->w() > bx1) bx1 = o->x() + o->w();
+      if (o->y() + o->h() > by1) by1 = o->y() + o->h();
+    }
+  }
+
+  // about 2 cells per child, but not smaller than 8 pixels:
+  double area = (double)(bx1 - bx0) * (by1 - by0);
+  cell = (int)sqrt(area / (2.0 * n)) + 1;
+  if (cell < 8) cell = 8;
+  x0 = bx0; y0 = by0;
+  cols = first ? 0 : (bx1 - bx0 + cell - 1) / cell;
+  rows = first ? 0 : (by1 - by0 + cell - 1) / cell;
+
+  int ncells = cols * rows;
+  start = new int[ncells + 1];
+  memset(start, 0, (ncells + 1) * sizeof(int));
+  int *span = new int[4 * n];	// cell range of each child, c0 < 0 for "big"
+
+  // count the children of each cell:
+  for (i = 0; i < n; i ++) {
+    Fl_Widget *o = a[i];
+    int *s = span + 4 * i;
+    if (o->w() <= 0 || o->h() <= 0) { s[0] = -1; nbig ++; continue; }
+    s[0] = (o->x() - x0) / cell;
+    s[1] = (o->y() - y0) / cell;
+    s[2] = (o->x() + o->w() - 1 - x0) / cell;
+    s[3] = (o->y() + o->h() - 1 - y0) / cell;
+    if ((s[2] - s[0] + 1) * (s[3] - s[1] + 1) > INDEX_MAX_SPAN) {
+      s[0] = -1; nbig ++; continue;
+    }
+    for (int r = s[1]; r <= s[3]; r ++)
+      for (int c = s[0]; c <= s[2]; c ++) start[r * cols + c + 1] ++;
+  }
+  for (i = 0; i < ncells; i ++) start[i + 1] += start[i];
+
+  // ...and store them in ascending order:
+  items = new int[start[ncells] ? start[ncells] : 1];
+  big = new int[nbig ? nbig : 1];
+  int *fill = new int[ncells ? ncells : 1];
+  memcpy(fill, start, ncells * sizeof(int));
+  nbig = 0;
+  for (i = 0; i < n; i ++) {
+    int *s = span + 4 * i;
+    if (s[0] < 0) { big[nbig ++] = i; continue; }
+    for (int r = s[1]; r <= s[3]; r ++)
+      for (int c = s[0]; c <= s[2]; c ++) items[fill[r * cols + c] ++] = i;
+  }
+  delete[] fill;
+  delete[] span;
+}
+
+// Stores the indices of the children that may contain the point in
+// out[] in descending order and returns their number. out[] must have
+// room for the children of the cell and the "big" list.
+int Fl_Group_Index::point(int x, int y, int *out) {
+  int c = x - x0, r = y - y0;
+  const int *p = items, *pe = items;
+  if (c >= 0 && r >= 0 && c / cell < cols && r / cell < rows) {
+    int k = (r / cell) * cols + c / cell;
+    p = items + start[k]; pe = items + start[k + 1];
+  }
+  // merge the cell list and the big list, both are ascending:
+  const int *q = big + nbig;
+  int m = 0;
+  while (pe > p || q > big) {
+    if (pe > p && (q == big || pe[-1] > q[-1])) out[m ++] = *--pe;
+    else out[m ++] = *--q;
+  }
+  return m;
+}
+
+static int compare_ints(const void *a, const void *b) {
+  return *(const int *)a - *(const int *)b;
+}
+
+// Finds the children that may overlap the rectangle, in ascending
+// order in found[], and marks them with the current stampno:
+void Fl_Group_Index::rect(int x, int y, int w, int h) {
+  if (!++stampno) {	// wrapped around
+    memset(stamp, 0, n * sizeof(unsigned));
+    stampno = 1;
+  }
+  nfound = 0;
+  int i;
+  for (i = 0; i < nbig; i ++) {
+    stamp[big[i]] = stampno;
+    found[nfound ++] = big[i];
+  }
+  if (w > 0 && h > 0 && cols) {
+    int c0 = (x - x0) / cell, r0 = (y - y0) / cell;
+    int c1 = (x + w - 1 - x0) / cell, r1 = (y + h - 1 - y0) / cell;
+    if (x < x0) c0 = 0;
+    if (y < y0) r0 = 0;
+    if (c1 >= cols) c1 = cols - 1;
+    if (r1 >= rows) r1 = rows - 1;
+    for (int r = r0; r <= r1; r ++)
+      for (int c = c0; c <= c1; c ++) {
+        int k = r * cols + c;
+        for (int j = start[k]; j < start[k + 1]; j ++) {
+          int ci = items[j];
+          if (stamp[ci] == stampno) continue;
+          stamp[ci] = stampno;
+          found[nfound ++] = ci;
+        }
+      }
+  }
+  qsort(found, nfound, sizeof(int), compare_ints);
+}
+
+// Returns the up-to-date index of a group or NULL if it has none:
+static Fl_Group_Index *group_index(const Fl_Group *g) {
+  if (!g->spatial_index()) return 0;
+  Fl_Group_Index *ix = find_index(g);
+  if (ix && (ix->dirty || ix->n != g->children())) ix->build();
+  return ix;
+}
+
+/**
+  Enables or disables a spatial index of the children.
+
+  Groups with many children, for instance a canvas with thousands of
+  widgets, spend most of their time in handle() and draw_children()
+  looking for the children under the mouse or inside the clip region.
+  With the index, only the children near the mouse position or the
+  clip region are checked.
+
+  The index is updated automatically when children are added, removed,
+  or resized with resize(), position(), or size(). If you change the
+  position of children otherwise, call init_sizes().
+
+  The index needs about 4 integers per child and is disabled by default.
+
+  \param[in] on non-zero to use an index
+  \see spatial_index() const
+*/
+void Fl_Group::spatial_index(int on) {
+  Fl_Group_Index *ix = find_index(this);
+  if (on) {
+    set_flag(SPATIAL_INDEX);
+    if (!ix) {
+      ix = new Fl_Group_Index;
+      memset(ix, 0, sizeof(*ix));
+      ix->group = this;
+      ix->dirty = 1;
+      ix->next  = first_index;
+      first_index = ix;
+    }
+  } else {
+    clear_flag(SPATIAL_INDEX);
+    if (!ix) return;
+    Fl_Group_Index **pp = &first_index;
+    while (*pp != ix) pp = &(*pp)->next;
+    *pp = ix->next;
+    delete[] ix->start; delete[] ix->items; delete[] ix->big;
+    delete[] ix->stamp; delete[] ix->found;
+    delete ix;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+// Offscreen cache, see Fl_Group::cache_mode(int)
+
+// The group is drawn into an offscreen pixmap, which is copied to the
+// window instead of drawing the group. The pixmap is drawn again when a
+// widget of the group is damaged, when the position, size, or visibility
+// of a widget of the group changed, when widgets were added or removed,
+// and after Fl::scheme() or color changes.
+
+struct Fl_Group_Cache {
+  Fl_Group *group;
+  Fl_Group_Cache *next;
+  Fl_Offscreen offscreen;
+  int w, h;			// size of the offscreen
+  unsigned sum;			// cache_sum() of the offscreen
+  int valid;			// no damage since the offscreen was drawn
+  int drawing;			// the offscreen is being drawn
+};
+
+static Fl_Group_Cache *first_cache = 0;
+
+static Fl_Group_Cache *find_cache(const Fl_Group *g) {
+  for (Fl_Group_Cache *c = first_cache; c; c = c->next)
+    if (c->group == g) return c;
+  return 0;
+}
+
+// Marks the offscreen of a group as out of date. Called for each group
+// with cache_mode() between a damaged widget and its window (from
+// Fl_Widget::damage()). Returns non-zero if the damage must not be
+// passed to the parents, which is the case when the group is damaged
+// to draw it into its offscreen:
+int fl_group_cache_damaged(Fl_Group *g, Fl_Widget *w) {
+  Fl_Group_Cache *c = find_cache(g);
+  if (!c) return 0;
+  if (c->drawing && w == g) return 1;
+  c->valid = 0;
+  return 0;
+}
+
+// Marks the offscreens of all groups as out of date. Called when the
+// scheme or a color changed (from Fl::reload_scheme() and Fl::set_color()):
+void fl_group_cache_changed() {
+  for (Fl_Group_Cache *c = first_cache; c; c = c->next) c->valid = 0;
+}
+
+// Sums up the relative geometry and visibility of all widgets of a group:
+static unsigned cache_sum(Fl_Group *g, int X, int Y, unsigned sum) {
+  Fl_Widget*const* a = g->array();
+  for (int i = g->children(); i--;) {
+    Fl_Widget *o = *a++;
+    sum = sum * 31 + (unsigned)(fl_intptr_t)o;
+    sum = sum * 31 + (unsigned)(o->x() - X);
+    sum = sum * 31 + (unsigned)(o->y() - Y);
+    sum = sum * 31 + (unsigned)(o->w() << 16 ^ o->h());
+    sum = sum * 31 + (unsigned)o->visible();
+    Fl_Group *c = o->as_group();
+    if (c && o->visible()) sum = cache_sum(c, X, Y, sum);
+  }
+  return sum;
+}
+
+// Draws the group into its offscreen. The group is drawn at the origin
+// of the offscreen by a surface that translates all coordinates, the
+// same one that Fl_Image_Surface uses:
+static void draw_offscreen(Fl_Group_Cache *c) {
+  Fl_Group *g = c->group;
+  fl_begin_offscreen(c->offscreen);
+#if defined(__APPLE__)
+  Fl_Quartz_Surface_ surf(c->w, c->h);
+#elif defined(WIN32)
+  Fl_GDI_Surface_ surf;
+#else
+  Fl_Xlib_Surface_ surf;
+#endif
+  surf.set_current();
+  fl_color(g->color());
+  fl_rectf(0, 0, c->w, c->h);
+  surf.print_widget(g);
+  Fl_Display_Device::display_device()->set_current();
+  fl_end_offscreen();
+}
+
+// Draws a child from its offscreen if it is a group with cache_mode(),
+// the offscreen is updated first if needed. Returns 0 if the child must
+// be drawn with its draw() method:
+static int draw_cached(Fl_Widget &widget) {
+  Fl_Group *g = widget.as_group();
+  if (!g || !g->cache_mode() ||
+      Fl_Surface_Device::surface() != Fl_Display_Device::display_device())
+    return 0;
+  Fl_Group_Cache *c = find_cache(g);
+  if (!c || g->w() <= 0 || g->h() <= 0) return 0;
+
+  unsigned sum = cache_sum(g, g->x(), g->y(), (unsigned)(g->w() << 16 ^ g->h()));
+
+  if (!c->offscreen || !c->valid || c->sum != sum) {
+    if (c->offscreen && (c->w != g->w() || c->h != g->h())) {
+      fl_delete_offscreen(c->offscreen);
+      c->offscreen = 0;
+    }
+    if (!c->offscreen) {
+      c->w = g->w();
+      c->h = g->h();
+      c->offscreen = fl_create_offscreen(c->w, c->h);
+      if (!c->offscreen) return 0;
+    }
+    // widgets of the group that are damaged while they are drawn make
+    // the offscreen invalid again:
+    c->valid   = 1;
+    c->drawing = 1;
+    g->clear_damage(FL_DAMAGE_ALL);
+    draw_offscreen(c);
+    c->drawing = 0;
+    c->sum     = sum;
+  }
+
+  fl_copy_offscreen(g->x(), g->y(), c->w, c->h, c->offscreen, 0, 0);
+  return 1;
+}
+
+/**
+  Enables or disables drawing the group from an offscreen image.
+
+  Panels with many widgets that rarely change, for instance labels,
+  boxes, and frames drawn with the "gtk+" or "plastic" scheme, are drawn
+  again from their primitives whenever their area of the window is
+  redrawn. With the cache, the group is drawn once into an offscreen
+  pixmap, and the pixmap is copied to the window instead.
+
+  The pixmap is drawn again automatically when any widget of the group
+  is damaged, i.e. calls redraw() or damage(), when widgets of the group
+  are resized, moved, shown, hidden, added, or removed, and when the
+  scheme or a color of the color map is changed with Fl::scheme() or
+  Fl::set_color(). Moving the group itself doesn't update the pixmap.
+
+  The cache is used only when the group is drawn by its parent on the
+  display, it is not used for printing. The pixmap is filled with color()
+  before the group is drawn, so the group should have a box type that
+  fills its area. Subwindows of the group are not cached.
+
+  The pixmap of the size of the group stays on the server, no image
+  data is kept in the client. The cache is disabled by default.
+
+  \param[in] on non-zero to draw the group from an offscreen image
+  \see cache_mode() const
+*/
+void Fl_Group::cache_mode(int on) {
+  Fl_Group_Cache *c = find_cache(this);
+  if (on) {
+    set_flag(CACHE_MODE);
+    if (!c) {
+      c = new Fl_Group_Cache;
+      memset(c, 0, sizeof(*c));
+      c->group = this;
+      c->next  = first_cache;
+      first_cache = c;
+    }
+  } else {
+    clear_flag(CACHE_MODE);
+    if (!c) return;
+    Fl_Group_Cache **pp = &first_cache;
+    while (*pp != c) pp = &(*pp)->next;
+    *pp = c->next;
+    if (c->offscreen) fl_delete_offscreen(c->offscreen);
+    delete c;
+  }
+}
+
+// The children that handle() tries for events at the mouse position,
+// topmost first. Without an index this is simply all children:
+class Fl_Group_Hits {
+  Fl_Widget*const* array_;
+  int n_;
+  int *index_;
+  int buf_[64];
+public:
+  Fl_Group_Hits(Fl_Group *g) {
+    array_ = g->array();
+    n_     = g->children();
+    index_ = 0;
+    Fl_Group_Index *ix = group_index(g);
+    if (!ix || !ix->n) return;
+    int x = Fl::event_x(), y = Fl::event_y(), c = x - ix->x0, r = y - ix->y0;
+    int max = ix->nbig;
+    if (c >= 0 && r >= 0 && c / ix->cell < ix->cols && r / ix->cell < ix->rows) {
+      int k = (r / ix->cell) * ix->cols + c / ix->cell;
+      max += ix->start[k + 1] - ix->start[k];
+    }
+    index_ = max <= 64 ? buf_ : new int[max];
+    n_ = ix->point(x, y, index_);
+  }
+  ~Fl_Group_Hits() { if (index_ != buf_) delete[] index_; }
+  int count() const { return n_; }
+  Fl_Widget *operator[](int i) const {
+    return index_ ? array_[index_[i]] : array_[n_ - 1 - i];
+  }
+};
+
 int Fl_Group::handle(int event) {
 
   Fl_Widget*const* a = array();
@@ -174,12 +606,13 @@ int Fl_Group::handle(int event) {
   case FL_KEYBOARD:
     return navigation(navkey());
 
-  case FL_SHORTCUT:
-    for (i = children(); i--;) {
-      o = a[i];
+  case FL_SHORTCUT: {
+    Fl_Group_Hits hits(this);
+    for (i = 0; i < hits.count(); i++) {
+      o = hits[i];
       if (o->takesevents() && Fl::event_inside(o) && send(o,FL_SHORTCUT))
 	return 1;
-    }
+    }}
     for (i = children(); i--;) {
       o = a[i];
       if (o->takesevents() && !Fl::event_inside(o) && send(o,FL_SHORTCUT))
@@ -189,9 +622,10 @@ int Fl_Group::handle(int event) {
     return 0;
 
   case FL_ENTER:
-  case FL_MOVE:
-    for (i = children(); i--;) {
-      o = a[i];
+  case FL_MOVE: {
+    Fl_Group_Hits hits(this);
+    for (i = 0; i < hits.count(); i++) {
+      o = hits[i];
       if (o->visible() && Fl::event_inside(o)) {
 	if (o->contains(Fl::belowmouse())) {
 	  return send(o,FL_MOVE);
@@ -202,12 +636,13 @@ int Fl_Group::handle(int event) {
       }
     }
     Fl::belowmouse(this);
-    return 1;
+    return 1;}
 
   case FL_DND_ENTER:
-  case FL_DND_DRAG:
-    for (i = children(); i--;) {
-      o = a[i];
+  case FL_DND_DRAG: {
+    Fl_Group_Hits hits(this);
+    for (i = 0; i < hits.count(); i++) {
+      o = hits[i];
       if (o->takesevents() && Fl::event_inside(o)) {
 	if (o->contains(Fl::belowmouse())) {
 	  return send(o,FL_DND_DRAG);
@@ -218,11 +653,12 @@ int Fl_Group::handle(int event) {
       }
     }
     Fl::belowmouse(this);
-    return 0;
+    return 0;}
 
-  case FL_PUSH:
-    for (i = children(); i--;) {
-      o = a[i];
+  case FL_PUSH: {
+    Fl_Group_Hits hits(this);
+    for (i = 0; i < hits.count(); i++) {
+      o = hits[i];
       if (o->takesevents() && Fl::event_inside(o)) {
 	Fl_Widget_Tracker wp(o);
 	if (send(o,FL_PUSH)) {
@@ -231,7 +667,7 @@ int Fl_Group::handle(int event) {
 	}
       }
     }
-    return 0;
+    return 0;}
 
   case FL_RELEASE:
   case FL_DRAG:
@@ -239,8 +675,9 @@ int Fl_Group::handle(int event) {
     if (o == this) return 0;
     else if (o) send(o,event);
     else {
-      for (i = children(); i--;) {
-	o = a[i];
+      Fl_Group_Hits hits(this);
+      for (i = 0; i < hits.count(); i++) {
+	o = hits[i];
 	if (o->takesevents() && Fl::event_inside(o)) {
 	  if (send(o,event)) return 1;
 	}
@@ -248,12 +685,13 @@ int Fl_Group::handle(int event) {
     }
     return 0;
 
-  case FL_MOUSEWHEEL:
-    for (i = children(); i--;) {
-      o = a[i];
+  case FL_MOUSEWHEEL: {
+    Fl_Group_Hits hits(this);
+    for (i = 0; i < hits.count(); i++) {
+      o = hits[i];
       if (o->takesevents() && Fl::event_inside(o) && send(o,FL_MOUSEWHEEL))
 	return 1;
-    }
+    }}
     for (i = children(); i--;) {
       o = a[i];
       if (o->takesevents() && !Fl::event_inside(o) && send(o,FL_MOUSEWHEEL))
@@ -447,6 +885,8 @@ void Fl_Group::clear() {
 */
 Fl_Group::~Fl_Group() {
   clear();
+  if (spatial_index()) spatial_index(0);
+  if (cache_mode()) cache_mode(0);
 }
 
 /**
@@ -571,6 +1011,7 @@ void Fl_Group::remove(Fl_Widget &o) {
 */
 void Fl_Group::init_sizes() {
   delete[] sizes_; sizes_ = 0;
+  if (spatial_index()) fl_group_index_changed(this);
 }
 
 /**
@@ -722,7 +1163,22 @@ void Fl_Group::draw_children() {
 		 h() - Fl::box_dh(box()));
   }
 
-  if (damage() & ~FL_DAMAGE_CHILD) { // redraw the entire thing:
+  Fl_Group_Index *ix = fl_clip_region() ? group_index(this) : 0;
+  if (ix) {
+    // only the children near the clip region can be drawn:
+    int X, Y, W, H;
+    fl_clip_box(-32000, -32000, 64000, 64000, X, Y, W, H);
+    ix->rect(X, Y, W, H);
+    if (damage() & ~FL_DAMAGE_CHILD) { // redraw the entire thing:
+      for (int i = 0; i < children_; i++) {
+	Fl_Widget& o = *a[i];
+	if (ix->stamp[i] == ix->stampno) draw_child(o);
+	draw_outside_label(o);
+      }
+    } else {	// only redraw the children that need it:
+      for (int i = 0; i < ix->nfound; i++) update_child(*a[ix->found[i]]);
+    }
+  } else if (damage() & ~FL_DAMAGE_CHILD) { // redraw the entire thing:
     for (int i=children_; i--;) {
       Fl_Widget& o = **a++;
       draw_child(o);
@@ -743,6 +1199,10 @@ void Fl_Group::draw() {
   draw_children();
 }
 
+extern int fl_profiling; // in Fl_Profiler.cxx
+extern void fl_profile_begin(Fl_Widget*);
+extern void fl_profile_end(Fl_Widget*);
+
 /**
   Draws a child only if it needs it.
 
@@ -754,7 +1214,9 @@ void Fl_Group::draw() {
 void Fl_Group::update_child(Fl_Widget& widget) const {
   if (widget.damage() && widget.visible() && widget.type() < FL_WINDOW &&
       fl_not_clipped(widget.x(), widget.y(), widget.w(), widget.h())) {
-    widget.draw();	
+    if (fl_profiling) fl_profile_begin(&widget);
+    if (!draw_cached(widget)) widget.draw();
+    if (fl_profiling) fl_profile_end(&widget);
     widget.clear_damage();
   }
 }
@@ -769,7 +1231,9 @@ void Fl_Group::draw_child(Fl_Widget& widget) const {
   if (widget.visible() && widget.type() < FL_WINDOW &&
       fl_not_clipped(widget.x(), widget.y(), widget.w(), widget.h())) {
     widget.clear_damage(FL_DAMAGE_ALL);
-    widget.draw();
+    if (fl_profiling) fl_profile_begin(&widget);
+    if (!draw_cached(widget)) widget.draw();
+    if (fl_profiling) fl_profile_end(&widget);
     widget.clear_damage();
   }
 }
@@ -24,9 +24,16 @@
 #include <FL/Fl_Image.H>
 #include <FL/Fl_Printer.H>
 #include "flstring.h"
+#include <config.h>
 
 #ifdef WIN32
 void fl_release_dc(HWND, HDC); // from Fl_win32.cxx
+#elif !defined(__APPLE__)
+void fl_sync_gc(); // from fl_rect.cxx
+#  if HAVE_XRENDER
+#    include <X11/extensions/Xrender.h>
+static void free_image_picture(Fl_Offscreen pixmap);
+#  endif
 #endif
 
 void fl_restore_clip(); // from fl_rect.cxx
@@ -310,6 +317,9 @@ void Fl_RGB_Image::uncache() {
   }
 #else
   if (id_) {
+#  if !defined(WIN32) && HAVE_XRENDER
+    free_image_picture((Fl_Offscreen)id_);
+#  endif // !WIN32 && HAVE_XRENDER
     fl_delete_offscreen((Fl_Offscreen)id_);
     id_ = 0;
   }
@@ -569,61 +579,134 @@ void Fl_RGB_Image::desaturate() {
 
 #if !defined(WIN32) && !defined(__APPLE__)
 // Composite an image with alpha on systems that don't have accelerated
-// alpha compositing...
+// alpha compositing.  Fully transparent and fully opaque pixels are
+// handled without arithmetic; the blend uses exact rounding (x/255)...
 static void alpha_blend(Fl_RGB_Image *img, int X, int Y, int W, int H, int cx, int cy) {
+  int d = img->d();
   int ld = img->ld();
-  if (ld == 0) ld = img->w() * img->d();
-  uchar *srcptr = (uchar*)img->array + cy * ld + cx * img->d();
-  int srcskip = ld - img->d() * W;
+  if (ld == 0) ld = img->w() * d;
+  const uchar *srcptr = img->array + cy * ld + cx * d;
+
+  // Skip the read-back of the destination if the area is opaque...
+  int opaque = 1;
+  for (int y = 0; opaque && y < H; y++) {
+    const uchar *a = srcptr + y * ld + d - 1;
+    for (int x = W; x > 0; x--, a += d)
+      if (*a != 255) { opaque = 0; break; }
+  }
+  if (opaque) {
+    fl_draw_image(srcptr, X, Y, W, H, d, ld);
+    return;
+  }
 
   uchar *dst = new uchar[W * H * 3];
   uchar *dstptr = dst;
 
   fl_read_image(dst, X, Y, W, H, 0);
 
-  uchar srcr, srcg, srcb, srca;
-  uchar dstr, dstg, dstb, dsta;
-
-  if (img->d() == 2) {
-    // Composite grayscale + alpha over RGB...
-    for (int y = H; y > 0; y--, srcptr+=srcskip)
-      for (int x = W; x > 0; x--) {
-	srcg = *srcptr++;
-	srca = *srcptr++;
-
-	dstr = dstptr[0];
-	dstg = dstptr[1];
-	dstb = dstptr[2];
-	dsta = 255 - srca;
-
-	*dstptr++ = (srcg * srca + dstr * dsta) >> 8;
-	*dstptr++ = (srcg * srca + dstg * dsta) >> 8;
-	*dstptr++ = (srcg * srca + dstb * dsta) >> 8;
-      }
-  } else {
-    // Composite RGBA over RGB...
-    for (int y = H; y > 0; y--, srcptr+=srcskip)
-      for (int x = W; x > 0; x--) {
-	srcr = *srcptr++;
-	srcg = *srcptr++;
-	srcb = *srcptr++;
-	srca = *srcptr++;
-
-	dstr = dstptr[0];
-	dstg = dstptr[1];
-	dstb = dstptr[2];
-	dsta = 255 - srca;
-
-	*dstptr++ = (srcr * srca + dstr * dsta) >> 8;
-	*dstptr++ = (srcg * srca + dstg * dsta) >> 8;
-	*dstptr++ = (srcb * srca + dstb * dsta) >> 8;
+  for (int y = H; y > 0; y--, srcptr += ld) {
+    const uchar *src = srcptr;
+    for (int x = W; x > 0; x--, src += d, dstptr += 3) {
+      unsigned srca = src[d - 1];
+      if (!srca) continue;
+
+      // Grayscale + alpha uses the same value for all 3 channels...
+      unsigned srcr = src[0];
+      unsigned srcg = d == 2 ? srcr : src[1];
+      unsigned srcb = d == 2 ? srcr : src[2];
+
+      if (srca == 255) {
+        dstptr[0] = (uchar)srcr;
+        dstptr[1] = (uchar)srcg;
+        dstptr[2] = (uchar)srcb;
+      } else {
+        unsigned dsta = 255 - srca, t;
+        t = srcr * srca + dstptr[0] * dsta + 128; dstptr[0] = (uchar)((t + (t >> 8)) >> 8);
+        t = srcg * srca + dstptr[1] * dsta + 128; dstptr[1] = (uchar)((t + (t >> 8)) >> 8);
+        t = srcb * srca + dstptr[2] * dsta + 128; dstptr[2] = (uchar)((t + (t >> 8)) >> 8);
       }
+    }
   }
 
   fl_draw_image(dst, X, Y, W, H, 3, 0);
 
   delete[] dst;
 }
+
+// Returns non-zero if the alpha channel of an image is only 0 or 255,
+// so that a 1-bit mask represents it exactly...
+static int binary_alpha(Fl_RGB_Image *img) {
+  int d = img->d();
+  int ld = img->ld();
+  if (ld == 0) ld = img->w() * d;
+  for (int y = 0; y < img->h(); y++) {
+    const uchar *a = img->array + y * ld + d - 1;
+    for (int x = img->w(); x > 0; x--, a += d)
+      if (*a != 0 && *a != 255) return 0;
+  }
+  return 1;
+}
+
+#  if HAVE_XRENDER
+// XRender pictures of the ARGB offscreens of images are kept in a small
+// hash table indexed by pixmap, so that drawing an image only needs to
+// create the picture of the destination...
+struct Fl_Image_Picture {
+  Fl_Offscreen		pixmap;
+  Picture		picture;
+  Fl_Image_Picture	*next;
+};
+
+static Fl_Image_Picture *image_pictures[64];
+
+static Picture image_picture(Fl_Offscreen pixmap) {
+  Fl_Image_Picture **bucket = image_pictures + (pixmap % 64);
+  for (Fl_Image_Picture *p = *bucket; p; p = p->next)
+    if (p->pixmap == pixmap) return p->picture;
+
+  static XRenderPictFormat *fmt = XRenderFindStandardFormat(fl_display, PictStandardARGB32);
+  XRenderPictureAttributes attr;
+  memset(&attr, 0, sizeof(attr));
+  Picture picture = XRenderCreatePicture(fl_display, pixmap, fmt, 0, &attr);
+  if (!picture) return 0;
+
+  Fl_Image_Picture *p = new Fl_Image_Picture;
+  p->pixmap  = pixmap;
+  p->picture = picture;
+  p->next    = *bucket;
+  *bucket    = p;
+  return picture;
+}
+
+static void free_image_picture(Fl_Offscreen pixmap) {
+  for (Fl_Image_Picture **p = image_pictures + (pixmap % 64); *p; p = &((*p)->next))
+    if ((*p)->pixmap == pixmap) {
+      Fl_Image_Picture *next = (*p)->next;
+      XRenderFreePicture(fl_display, (*p)->picture);
+      delete *p;
+      *p = next;
+      return;
+    }
+}
+
+// Composite the ARGB offscreen of an image with PictOpOver...
+static int composite_image(Fl_Offscreen pixmap, int X, int Y, int W, int H, int cx, int cy) {
+  Picture src = image_picture(pixmap);
+  if (!src) return 0;
+
+  static XRenderPictFormat *dstfmt = XRenderFindStandardFormat(fl_display, PictStandardRGB24);
+  XRenderPictureAttributes attr;
+  memset(&attr, 0, sizeof(attr));
+  Picture dst = XRenderCreatePicture(fl_display, fl_window, dstfmt, 0, &attr);
+  if (!dst) return 0;
+
+  Fl_Region r = fl_clip_region();
+  if (r) XRenderSetPictureClipRegion(fl_display, dst, r);
+  XRenderComposite(fl_display, PictOpOver, src, None, dst, cx, cy, 0, 0, X, Y, W, H);
+  XRenderFreePicture(fl_display, dst);
+  return 1;
+}
+#  endif // HAVE_XRENDER
 #endif // !WIN32 && !__APPLE__
 
 void Fl_RGB_Image::draw(int XP, int YP, int WP, int HP, int cx, int cy) {
@@ -803,18 +886,27 @@ void Fl_Xlib_Graphics_Driver::draw(Fl_RGB_Image *img, int XP, int YP, int WP, in
   if (start(img, XP, YP, WP, HP, img->w(), img->h(), cx, cy, X, Y, W, H)) {
     return;
   }
+  fl_sync_gc();
+  int alpha = img->d() == 2 || img->d() == 4;
   if (!img->id_) {
-    if (img->d() == 1 || img->d() == 3) {
+    if (!alpha) {
       img->id_ = fl_create_offscreen(img->w(), img->h());
       fl_begin_offscreen((Fl_Offscreen)img->id_);
       fl_draw_image(img->array, 0, 0, img->w(), img->h(), img->d(), img->ld());
       fl_end_offscreen();
-    } else if (img->d() == 4 && fl_can_do_alpha_blending()) {
+    } else if (fl_can_do_alpha_blending()) {
       img->id_ = fl_create_offscreen_with_alpha(img->w(), img->h());
       fl_begin_offscreen((Fl_Offscreen)img->id_);
       fl_draw_image(img->array, 0, 0, img->w(), img->h(), img->d() | FL_IMAGE_WITH_ALPHA,
                     img->ld());
       fl_end_offscreen();
+    } else if (binary_alpha(img)) {
+      // Without XRender, a mask is exact for images without translucency...
+      img->id_ = fl_create_offscreen(img->w(), img->h());
+      fl_begin_offscreen((Fl_Offscreen)img->id_);
+      fl_draw_image(img->array, 0, 0, img->w(), img->h(), img->d(), img->ld());
+      fl_end_offscreen();
+      img->mask_ = fl_create_alphamask(img->w(), img->h(), img->d(), img->ld(), img->array);
     }
   }
   if (img->id_) {
@@ -831,9 +923,12 @@ void Fl_Xlib_Graphics_Driver::draw(Fl_RGB_Image *img, int XP, int YP, int WP, in
       XSetClipOrigin(fl_display, fl_gc, X-cx, Y-cy);
     }
 
-    if (img->d() == 4 && fl_can_do_alpha_blending())
-      copy_offscreen_with_alpha(X, Y, W, H, img->id_, cx, cy);
-    else
+    if (alpha && !img->mask_) {
+#  if HAVE_XRENDER
+      if (!composite_image(img->id_, X, Y, W, H, cx, cy))
+#  endif // HAVE_XRENDER
+        copy_offscreen_with_alpha(X, Y, W, H, img->id_, cx, cy);
+    } else
       copy_offscreen(X, Y, W, H, img->id_, cx, cy);
 
     if (img->mask_) {
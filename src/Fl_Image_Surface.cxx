@@ -77,6 +77,11 @@ Fl_Image_Surface::Fl_Image_Surface(int w, int h) : Fl_Surface_Device(NULL) {
 #endif
 
 
+#if !defined(__APPLE__) && !defined(WIN32)
+void fl_sync_gc(); // from fl_rect.cxx
+void fl_forget_gc(GC gc); // from fl_rect.cxx
+#endif
+
 /** The destructor.
  */
 Fl_Image_Surface::~Fl_Image_Surface() {
@@ -89,8 +94,9 @@ Fl_Image_Surface::~Fl_Image_Surface() {
   fl_delete_offscreen(offscreen);
   delete (Fl_GDI_Surface_*)helper;
 #else
+  fl_sync_gc(); // queued primitives may still draw into the offscreen
   fl_delete_offscreen(offscreen);
-  if (gc) { XFreeGC(fl_display, gc); fl_gc = 0; }
+  if (gc) { fl_forget_gc(gc); XFreeGC(fl_display, gc); fl_gc = 0; }
   delete (Fl_Xlib_Surface_*)helper;
 #endif
 }
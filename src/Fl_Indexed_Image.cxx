@@ -0,0 +1,362 @@
+//
+// "$Id$"
+//
+// Indexed image code for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2016 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+#include <FL/Fl.H>
+#include <FL/fl_draw.H>
+#include <FL/Fl_Indexed_Image.H>
+#include <stdio.h>
+#include "flstring.h"
+
+extern int fl_parse_pixmap_colors(const char*const* cdata, uchar* colors,
+                                  Fl_Color bg); // in fl_draw_pixmap.cxx
+
+
+/**
+  Expands palette indices to RGB or RGBA pixels.
+
+  This is the conversion used to draw indexed images and pixmaps. Each
+  pixel is a single 32-bit table lookup, processed 4 pixels at a time.
+
+  \param[in] indices	\p n palette indices
+  \param[in] n		number of pixels
+  \param[in] index_size	bytes per index, 1 or 2 (most significant byte first)
+  \param[in] palette	RGBA palette, 4 bytes per color
+  \param[out] out	\p n * \p depth bytes of pixel data
+  \param[in] depth	3 for RGB or 4 for RGBA pixels
+*/
+void Fl_Indexed_Image::expand(const uchar *indices, int n, int index_size,
+                              const uchar *palette, uchar *out, int depth) {
+  if (n <= 0) return;
+
+  if (depth == 4) {
+    if (index_size == 1) {
+      for (; n >= 4; n -= 4, indices += 4, out += 16) {
+        memcpy(out,      palette + 4 * indices[0], 4);
+        memcpy(out + 4,  palette + 4 * indices[1], 4);
+        memcpy(out + 8,  palette + 4 * indices[2], 4);
+        memcpy(out + 12, palette + 4 * indices[3], 4);
+      }
+      for (; n > 0; n --, indices ++, out += 4)
+        memcpy(out, palette + 4 * indices[0], 4);
+    } else {
+      for (; n >= 4; n -= 4, indices += 8, out += 16) {
+        memcpy(out,      palette + 4 * ((indices[0] << 8) | indices[1]), 4);
+        memcpy(out + 4,  palette + 4 * ((indices[2] << 8) | indices[3]), 4);
+        memcpy(out + 8,  palette + 4 * ((indices[4] << 8) | indices[5]), 4);
+        memcpy(out + 12, palette + 4 * ((indices[6] << 8) | indices[7]), 4);
+      }
+      for (; n > 0; n --, indices += 2, out += 4)
+        memcpy(out, palette + 4 * ((indices[0] << 8) | indices[1]), 4);
+    }
+  } else {
+    // Store 4 bytes per pixel; the alpha byte is overwritten by the next
+    // pixel, so only the last pixel is stored with 3 bytes...
+    int step = index_size == 1 ? 1 : 2;
+    for (; n > 1; n --, indices += step, out += 3)
+      memcpy(out, palette + 4 * (step == 1 ? indices[0] : (indices[0] << 8) | indices[1]), 4);
+    memcpy(out, palette + 4 * (step == 1 ? indices[0] : (indices[0] << 8) | indices[1]), 3);
+  }
+}
+
+
+//
+// 'Fl_Indexed_Image::init_()' - Allocate the indices and palette.
+//
+
+void Fl_Indexed_Image::init_(int W, int H, int index_size, int ncolors) {
+  if (index_size != 2) index_size = 1;
+  if (ncolors < 1) ncolors = 1;
+  if (ncolors > (1 << (8 * index_size))) ncolors = 1 << (8 * index_size);
+
+  w(W);
+  h(H);
+  index_size_ = index_size;
+  ncolors_    = ncolors;
+  indices_    = new uchar[W * H * index_size];
+
+  // 8-bit indices always have 256 palette entries, so that any index is valid
+  int nalloc = index_size == 1 ? 256 : ncolors;
+  palette_   = new uchar[4 * nalloc];
+  memset(palette_, 0, 4 * nalloc);
+}
+
+
+//
+// 'Fl_Indexed_Image::set_depth_()' - Use RGBA pixels only if needed.
+//
+
+void Fl_Indexed_Image::set_depth_() {
+  uchar used[256];
+  int i, n = w() * h();
+
+  d(3);
+
+  if (index_size_ == 1) {
+    memset(used, 0, sizeof(used));
+    for (i = 0; i < n; i ++) used[indices_[i]] = 1;
+    for (i = 0; i < 256; i ++)
+      if (used[i] && palette_[4 * i + 3] != 255) {
+        d(4);
+        return;
+      }
+  } else {
+    for (i = 0; i < ncolors_; i ++)
+      if (palette_[4 * i + 3] != 255) {
+        d(4);
+        return;
+      }
+  }
+}
+
+
+//
+// 'Fl_Indexed_Image::expand_()' - Expand the image for drawing.
+//
+
+void Fl_Indexed_Image::expand_() {
+  uchar *pixels = new uchar[w() * h() * d()];
+
+  expand(indices_, w() * h(), index_size_, palette_, pixels, d());
+
+  array       = pixels;
+  alloc_array = 1;
+}
+
+
+/**
+  Creates an indexed image from palette indices and a palette.
+  The indices and the palette are copied.
+
+  \param[in] indices	W * H * \p index_size bytes of palette indices
+  \param[in] W, H	size of the image
+  \param[in] palette	RGBA palette, 4 bytes per color
+  \param[in] ncolors	number of colors in the palette
+  \param[in] index_size	bytes per index, 1 or 2 (most significant byte first)
+*/
+Fl_Indexed_Image::Fl_Indexed_Image(const uchar *indices, int W, int H,
+                                   const uchar *palette, int ncolors,
+                                   int index_size)
+  : Fl_RGB_Image(0,0,0) {
+  indices_ = palette_ = 0;
+  ncolors_ = 0;
+  index_size_ = 1;
+
+  if (!indices || !palette || W <= 0 || H <= 0) return;
+
+  init_(W, H, index_size, ncolors);
+  memcpy(palette_, palette, 4 * ncolors_);
+
+  if (index_size_ == 1) {
+    memcpy(indices_, indices, W * H);
+  } else {
+    // Replace invalid indices by 0...
+    const uchar *src = indices;
+    uchar *dst = indices_;
+    for (int i = W * H; i > 0; i --, src += 2, dst += 2) {
+      if (((src[0] << 8) | src[1]) < ncolors_) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+      } else dst[0] = dst[1] = 0;
+    }
+  }
+
+  set_depth_();
+}
+
+
+/**
+  Creates an indexed image from XPM data, for instance the data() of an
+  Fl_Pixmap, Fl_XPM_Image, or Fl_GIF_Image.
+
+  The XPM color table is parsed once, so drawing, scaling, or color
+  changes of the image don't need to parse the XPM strings again.
+  Transparent XPM colors ("None") are transparent palette entries.
+
+  \param[in] xpm	XPM image data
+  \param[in] bg		RGB value stored in transparent palette entries
+*/
+Fl_Indexed_Image::Fl_Indexed_Image(const char * const *xpm, Fl_Color bg)
+  : Fl_RGB_Image(0,0,0) {
+  indices_ = palette_ = 0;
+  ncolors_ = 0;
+  index_size_ = 1;
+
+  int W, H, ncolors, cpp;
+
+  // The compressed FLTK colormap (ncolors < 0) has 1-character codes only
+  if (!xpm || !fl_measure_pixmap(xpm, W, H) ||
+      sscanf(xpm[0], "%*d%*d%d%d", &ncolors, &cpp) != 2 ||
+      cpp < 1 || cpp > 2 || (ncolors < 0 && cpp != 1)) {
+    ld(ERR_FORMAT);
+    return;
+  }
+
+  int ncodes = 1 << (8 * cpp);
+  uchar *colors = new uchar[4 * ncodes];
+  memset(colors, 0, 4 * ncodes);	// Undefined colors are transparent
+
+  if (!fl_parse_pixmap_colors(xpm, colors, bg)) {
+    delete[] colors;
+    ld(ERR_FORMAT);
+    return;
+  }
+
+  if (cpp == 1) {
+    // The pixel characters are the indices...
+    init_(W, H, 1, 256);
+    memcpy(palette_, colors, 4 * 256);
+
+    const char * const *rows = xpm + 1 + (ncolors < 0 ? 1 : ncolors);
+    for (int y = 0; y < H; y ++) memcpy(indices_ + y * W, rows[y], W);
+  } else {
+    // Map the 2-character color codes to consecutive indices...
+    unsigned short *map = new unsigned short[ncodes];
+    memset(map, 0, ncodes * sizeof(unsigned short));
+
+    init_(W, H, ncolors > 256 ? 2 : 1, ncolors);
+
+    for (int i = 0; i < ncolors && i < ncolors_; i ++) {
+      const uchar *p = (const uchar *)xpm[i + 1];
+      int code = (p[0] << 8) | p[1];
+      map[code] = (unsigned short)i;
+      memcpy(palette_ + 4 * i, colors + 4 * code, 4);
+    }
+
+    const uchar * const *rows = (const uchar * const *)(xpm + 1 + ncolors);
+    uchar *dst = indices_;
+    for (int y = 0; y < H; y ++) {
+      const uchar *p = rows[y];
+      for (int x = 0; x < W; x ++, p += 2) {
+        int index = map[(p[0] << 8) | p[1]];
+        if (index_size_ == 2) *dst++ = (uchar)(index >> 8);
+        *dst++ = (uchar)index;
+      }
+    }
+
+    delete[] map;
+  }
+
+  delete[] colors;
+
+  set_depth_();
+}
+
+
+/**
+  The destructor frees all memory and server resources that are used by
+  the image.
+*/
+Fl_Indexed_Image::~Fl_Indexed_Image() {
+  delete[] indices_;
+  delete[] palette_;
+}
+
+
+/**
+  Creates a resized copy of the image.
+  The palette indices are scaled with a nearest-neighbor algorithm.
+*/
+Fl_Image *Fl_Indexed_Image::copy(int W, int H) {
+  if (!indices_ || W <= 0 || H <= 0)
+    return new Fl_Indexed_Image((const uchar *)0, 0, 0, (const uchar *)0, 0);
+
+  if (W == w() && H == h())
+    return new Fl_Indexed_Image(indices_, W, H, palette_, ncolors_, index_size_);
+
+  int n = index_size_;
+  uchar *indices = new uchar[W * H * n];
+  uchar *dst = indices;
+
+  for (int y = 0; y < H; y ++) {
+    const uchar *row = indices_ + (y * h() / H) * w() * n;
+    for (int x = 0; x < W; x ++, dst += n)
+      memcpy(dst, row + (x * w() / W) * n, n);
+  }
+
+  Fl_Image *new_image = new Fl_Indexed_Image(indices, W, H, palette_, ncolors_, n);
+  delete[] indices;
+
+  return new_image;
+}
+
+
+/**
+  Blends the palette colors with a color.
+  \see Fl_Image::color_average(Fl_Color c, float i)
+*/
+void Fl_Indexed_Image::color_average(Fl_Color c, float i) {
+  if (!palette_) return;
+
+  // Get the color to blend with...
+  uchar		r, g, b;
+  unsigned	ia, ir, ig, ib;
+
+  Fl::get_color(c, r, g, b);
+  if (i < 0.0f) i = 0.0f;
+  else if (i > 1.0f) i = 1.0f;
+
+  ia = (unsigned)(256 * i);
+  ir = r * (256 - ia);
+  ig = g * (256 - ia);
+  ib = b * (256 - ia);
+
+  uchar *p = palette_;
+  for (int n = index_size_ == 1 ? 256 : ncolors_; n > 0; n --, p += 4) {
+    p[0] = (p[0] * ia + ir) >> 8;
+    p[1] = (p[1] * ia + ig) >> 8;
+    p[2] = (p[2] * ia + ib) >> 8;
+  }
+
+  uncache();
+  if (alloc_array) delete[] (uchar *)array;
+  array = 0;
+  alloc_array = 0;
+}
+
+
+/**
+  Converts the palette colors to grayscale.
+  \see Fl_Image::desaturate()
+*/
+void Fl_Indexed_Image::desaturate() {
+  if (!palette_) return;
+
+  uchar *p = palette_;
+  for (int n = index_size_ == 1 ? 256 : ncolors_; n > 0; n --, p += 4)
+    p[0] = p[1] = p[2] = (uchar)((p[0] * 31 + p[1] * 61 + p[2] * 8) / 100);
+
+  uncache();
+  if (alloc_array) delete[] (uchar *)array;
+  array = 0;
+  alloc_array = 0;
+}
+
+
+/**
+  Draws the image.
+  The palette indices are expanded to RGB or RGBA pixels on the first draw.
+*/
+void Fl_Indexed_Image::draw(int X, int Y, int W, int H, int cx, int cy) {
+  if (indices_ && !array) expand_();
+  Fl_RGB_Image::draw(X, Y, W, H, cx, cy);
+}
+
+
+//
+// End of "$Id$".
+//
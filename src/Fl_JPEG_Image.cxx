@@ -19,6 +19,8 @@
 // Contents:
 //
 //   Fl_JPEG_Image::Fl_JPEG_Image() - Load a JPEG image file.
+//   Fl_JPEG_Image::load_jpeg_()    - Load a JPEG image file, possibly reduced.
+//   Fl_JPEG_Image::shared_()       - Load a JPEG image file for Fl_Shared_Image.
 //
 
 //
@@ -98,6 +100,56 @@ extern "C" {
  */
 Fl_JPEG_Image::Fl_JPEG_Image(const char *filename)	// I - File to load
 : Fl_RGB_Image(0,0,0) {
+  load_jpeg_(filename, 0, 0);
+}
+
+
+/**
+ \brief The constructor loads a reduced-resolution JPEG image from the given
+ jpeg filename.
+
+ This is useful to create thumbnails: libjpeg can decode an image at 1/2,
+ 1/4, or 1/8 of its size for a fraction of the cost of a full decode.
+ The image is decoded at the smallest of these scales that is still at
+ least \p W x \p H pixels, so the resulting image is usually larger than
+ requested; use copy(W, H) to get the exact size. A zero \p W or \p H
+ does not constrain that dimension, and if both are zero the image is
+ decoded at full resolution.
+
+ Use Fl_Image::fail() to check if Fl_JPEG_Image failed to load.
+
+ \param[in] filename a full path and name pointing to a valid jpeg file.
+ \param[in] W, H the smallest size the decoded image should have
+ \version 1.3.4
+ */
+Fl_JPEG_Image::Fl_JPEG_Image(const char *filename, int W, int H)
+: Fl_RGB_Image(0,0,0) {
+  load_jpeg_(filename, W, H);
+}
+
+
+static int jpeg_reduced = 0;	// set when load_jpeg_() decoded a reduced image
+
+
+//
+// 'Fl_JPEG_Image::shared_()' - Load a JPEG image file for Fl_Shared_Image.
+//
+// Called by the image handler of fl_register_images(). Decodes the image
+// at the size that Fl_Shared_Image::get(name, W, H) asked for, if any,
+// and tells Fl_Shared_Image whether the image was reduced.
+//
+
+Fl_Image *Fl_JPEG_Image::shared_(const char *filename) {
+  jpeg_reduced = 0;
+  Fl_Image *img = new Fl_JPEG_Image(filename, Fl_Shared_Image::reduce_w_,
+                                    Fl_Shared_Image::reduce_h_);
+  if (jpeg_reduced) Fl_Shared_Image::reduced_ = 1;
+  return img;
+}
+
+
+void Fl_JPEG_Image::load_jpeg_(const char *filename, int W, int H)
+{
 #ifdef HAVE_LIBJPEG
   FILE				*fp;	// File pointer
   jpeg_decompress_struct	dinfo;	// Decompressor info
@@ -169,6 +221,18 @@ Fl_JPEG_Image::Fl_JPEG_Image(const char *filename)	// I - File to load
   dinfo.out_color_components = 3;
   dinfo.output_components    = 3;
   
+  if (W > 0 || H > 0) {
+    // Use the smallest DCT scale that still gives at least W x H pixels...
+    unsigned denom;
+    for (denom = 8; denom > 1; denom /= 2) {
+      if ((int)((dinfo.image_width + denom - 1) / denom) >= W &&
+          (int)((dinfo.image_height + denom - 1) / denom) >= H) break;
+    }
+    dinfo.scale_num   = 1;
+    dinfo.scale_denom = denom;
+    if (denom > 1) jpeg_reduced = 1;
+  }
+  
   jpeg_calc_output_dimensions(&dinfo);
   
   w(dinfo.output_width); 
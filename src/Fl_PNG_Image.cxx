@@ -20,6 +20,8 @@
 
 //
 //   Fl_PNG_Image::Fl_PNG_Image() - Load a PNG image file.
+//   Fl_Progressive_PNG_Image::feed() - Decode a piece of a PNG image.
+//   Fl_Progressive_PNG_Image::feed_mapped() - Decode a piece of a mapped file.
 //
 
 //
@@ -29,10 +31,23 @@
 #include <FL/Fl.H>
 #include <FL/Fl_PNG_Image.H>
 #include <FL/Fl_Shared_Image.H>
+#include <FL/Fl_Widget.H>
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <FL/fl_utf8.h>
+#include "flstring.h"
+
+#ifdef WIN32
+#  include <windows.h>
+#  include <io.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif // WIN32
 
 #if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
 extern "C"
@@ -67,6 +82,46 @@ extern "C" {
     png_mem_data->current += length;
   }
 } // extern "C"
+
+
+//
+// 'fl_png_set_transforms()' - Setup the conversion to grayscale or RGB.
+//
+// Returns the number of channels of the converted image.
+//
+
+static int fl_png_set_transforms(png_structp pp, png_infop info) {
+  int channels;	  // Number of color channels
+
+  if (png_get_color_type(pp, info) == PNG_COLOR_TYPE_PALETTE)
+    png_set_expand(pp);
+
+  if (png_get_color_type(pp, info) & PNG_COLOR_MASK_COLOR)
+    channels = 3;
+  else
+    channels = 1;
+
+  int num_trans = 0;
+  png_get_tRNS(pp, info, 0, &num_trans, 0);
+  if ((png_get_color_type(pp, info) & PNG_COLOR_MASK_ALPHA) || (num_trans != 0))
+    channels ++;
+
+  if (png_get_bit_depth(pp, info) < 8)
+  {
+    png_set_packing(pp);
+    png_set_expand(pp);
+  }
+  else if (png_get_bit_depth(pp, info) == 16)
+    png_set_strip_16(pp);
+
+#  if defined(HAVE_PNG_GET_VALID) && defined(HAVE_PNG_SET_TRNS_TO_ALPHA)
+  // Handle transparency...
+  if (png_get_valid(pp, info, PNG_INFO_tRNS))
+    png_set_tRNS_to_alpha(pp);
+#  endif // HAVE_PNG_GET_VALID && HAVE_PNG_SET_TRNS_TO_ALPHA
+
+  return channels;
+}
 #endif // HAVE_LIBPNG && HAVE_LIBZ
 
 
@@ -161,37 +216,12 @@ void Fl_PNG_Image::load_png_(const char *name_png, const unsigned char *buffer_p
   // Get the image dimensions and convert to grayscale or RGB...
   png_read_info(pp, info);
 
-  if (png_get_color_type(pp, info) == PNG_COLOR_TYPE_PALETTE)
-    png_set_expand(pp);
-
-  if (png_get_color_type(pp, info) & PNG_COLOR_MASK_COLOR)
-    channels = 3;
-  else
-    channels = 1;
-
-  int num_trans = 0;
-  png_get_tRNS(pp, info, 0, &num_trans, 0);
-  if ((png_get_color_type(pp, info) & PNG_COLOR_MASK_ALPHA) || (num_trans != 0))
-    channels ++;
+  channels = fl_png_set_transforms(pp, info);
 
   w((int)(png_get_image_width(pp, info)));
   h((int)(png_get_image_height(pp, info)));
   d(channels);
 
-  if (png_get_bit_depth(pp, info) < 8)
-  {
-    png_set_packing(pp);
-    png_set_expand(pp);
-  }
-  else if (png_get_bit_depth(pp, info) == 16)
-    png_set_strip_16(pp);
-
-#  if defined(HAVE_PNG_GET_VALID) && defined(HAVE_PNG_SET_TRNS_TO_ALPHA)
-  // Handle transparency...
-  if (png_get_valid(pp, info, PNG_INFO_tRNS))
-    png_set_tRNS_to_alpha(pp);
-#  endif // HAVE_PNG_GET_VALID && HAVE_PNG_SET_TRNS_TO_ALPHA
-
   if (((size_t)w()) * h() * d() > max_size() ) longjmp(png_jmpbuf(pp), 1);
   array = new uchar[w() * h() * d()];
   alloc_array = 1;
@@ -234,6 +264,306 @@ void Fl_PNG_Image::load_png_(const char *name_png, const unsigned char *buffer_p
 }
 
 
+//
+// Fl_Progressive_PNG_Image decoder state, driven by libpng's progressive
+// reader: png_process_data() calls the callbacks below as soon as enough
+// data for the image header, a row, or the end of the image has been seen.
+//
+
+struct Fl_Progressive_PNG_Image::Decoder {
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+  png_structp			pp;	// PNG read pointer
+  png_infop			info;	// PNG info pointer
+  Fl_Progressive_PNG_Image	*image;	// Image being decoded
+  int				updated;// Rows were decoded by this feed()
+
+  static void info_cb(png_structp pp, png_infop info);
+  static void row_cb(png_structp pp, png_bytep row, png_uint_32 row_num, int pass);
+  static void end_cb(png_structp pp, png_infop info);
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+};
+
+
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+void Fl_Progressive_PNG_Image::Decoder::info_cb(png_structp pp, png_infop info) {
+  Decoder *dec = (Decoder *)png_get_progressive_ptr(pp);
+  Fl_Progressive_PNG_Image *img = dec->image;
+
+  int channels = fl_png_set_transforms(pp, info);
+  png_set_interlace_handling(pp);
+  png_read_update_info(pp, info);
+
+  img->w((int)(png_get_image_width(pp, info)));
+  img->h((int)(png_get_image_height(pp, info)));
+  img->d(channels);
+
+  size_t size = ((size_t)img->w()) * img->h() * img->d();
+  if (size > max_size()) png_error(pp, "image too large");
+
+  // Rows that are not decoded yet are transparent or black...
+  uchar *array = new uchar[size];
+  memset(array, 0, size);
+  img->array       = array;
+  img->alloc_array = 1;
+}
+
+
+void Fl_Progressive_PNG_Image::Decoder::row_cb(png_structp pp, png_bytep row,
+                                               png_uint_32 row_num, int) {
+  if (!row) return;	// No change for this row of an interlaced pass
+
+  Decoder *dec = (Decoder *)png_get_progressive_ptr(pp);
+  Fl_Progressive_PNG_Image *img = dec->image;
+
+  if ((int)row_num >= img->h()) return;
+
+  png_bytep dst = (png_bytep)img->array + row_num * img->w() * img->d();
+  png_progressive_combine_row(pp, dst, row);
+
+#ifdef WIN32
+  // Some Windows graphics drivers don't honor transparency when RGB == white
+  if (img->d() == 4) {
+    // Convert RGB to 0 when alpha == 0...
+    for (int i = img->w(); i > 0; i --, dst += 4)
+      if (!dst[3]) dst[0] = dst[1] = dst[2] = 0;
+  }
+#endif // WIN32
+
+  img->rows_ ++;
+  dec->updated = 1;
+}
+
+
+void Fl_Progressive_PNG_Image::Decoder::end_cb(png_structp pp, png_infop) {
+  Decoder *dec = (Decoder *)png_get_progressive_ptr(pp);
+  dec->image->done_ = 1;
+}
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+
+
+/**
+ Creates an empty image that is filled by feed().
+
+ \param[in] widget	the widget to redraw when new rows are decoded, or NULL
+ */
+Fl_Progressive_PNG_Image::Fl_Progressive_PNG_Image(Fl_Widget *widget)
+: Fl_PNG_Image() {
+  decoder_  = 0;
+  widget_   = widget;
+  rows_     = 0;
+  done_     = 0;
+  map_      = 0;
+  map_size_ = 0;
+  map_pos_  = 0;
+  alloc_array = 0;
+  array = (uchar *)0;
+
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+  decoder_ = new Decoder;
+  decoder_->image   = this;
+  decoder_->updated = 0;
+  decoder_->info    = 0;
+  decoder_->pp      = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (decoder_->pp) decoder_->info = png_create_info_struct(decoder_->pp);
+  if (!decoder_->pp || !decoder_->info) {
+    Fl::warning("Cannot allocate memory to read PNG data.\n");
+    finish_(-1);
+    return;
+  }
+
+  png_set_progressive_read_fn(decoder_->pp, decoder_, Decoder::info_cb,
+                              Decoder::row_cb, Decoder::end_cb);
+#else
+  finish_(-1);
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+}
+
+
+/**
+ The destructor stops decoding and frees all memory and server resources
+ that are used by the image.
+ */
+Fl_Progressive_PNG_Image::~Fl_Progressive_PNG_Image() {
+  if (decoder_) finish_(-1);
+  unmap_();
+}
+
+
+//
+// 'Fl_Progressive_PNG_Image::finish_()' - Free the decoder once done.
+//
+
+void Fl_Progressive_PNG_Image::finish_(int status) {
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+  if (decoder_) {
+    if (decoder_->pp) png_destroy_read_struct(&decoder_->pp,
+                                              decoder_->info ? &decoder_->info : NULL,
+                                              NULL);
+    delete decoder_;
+    decoder_ = 0;
+  }
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+
+  unmap_();
+
+  done_ = status;
+
+  if (status < 0 && !w()) ld(ERR_FORMAT);
+}
+
+
+/**
+ Decodes the next piece of PNG data.
+
+ The data can be split at any position. Rows that are completed by this
+ piece are stored into the image, the cached image is released so that
+ the next draw() shows them, and the widget() is redrawn.
+
+ If the data can't be decoded, the partially decoded rows are kept and
+ -1 is returned; fail() returns ERR_FORMAT if not even the image header
+ could be read.
+
+ \param[in] data	the next bytes of the PNG data stream
+ \param[in] length	the number of bytes
+ \return 1 if the image is complete, 0 if more data is needed, -1 on error
+ */
+int Fl_Progressive_PNG_Image::feed(const unsigned char *data, size_t length) {
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+  if (!decoder_) return done_;
+
+  if (setjmp(png_jmpbuf(decoder_->pp))) {
+    Fl::warning("PNG data is too large or contains errors!\n");
+    finish_(-1);
+    uncache();
+    if (widget_) widget_->redraw();
+    return -1;
+  }
+
+  decoder_->updated = 0;
+  png_process_data(decoder_->pp, decoder_->info, (png_bytep)data, length);
+
+  if (decoder_->updated) {
+    uncache();
+    if (widget_) widget_->redraw();
+  }
+
+  if (done_) finish_(1);
+
+  return done_;
+#else
+  return -1;
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+}
+
+
+/**
+ Decodes the next \p length bytes of the file mapped with map().
+
+ The data is read directly from the memory-mapped file without copying
+ it to an intermediate buffer. The mapping is released when the image is
+ complete or an error occurs.
+
+ \param[in] length	maximum number of bytes to decode
+ \return 1 if the image is complete, 0 if more data is needed, -1 on error
+ or if the mapped file ends before the image is complete
+ */
+int Fl_Progressive_PNG_Image::feed_mapped(size_t length) {
+  if (!map_) return done_ ? done_ : -1;
+
+  const unsigned char *data = map_ + map_pos_;
+
+  if (length > map_size_ - map_pos_) length = map_size_ - map_pos_;
+  map_pos_ += length;
+
+  int status = feed(data, length);
+
+  if (status == 0 && map_pos_ >= map_size_) {
+    Fl::warning("PNG data is truncated!\n");
+    finish_(-1);
+    status = -1;
+  }
+
+  return status;
+}
+
+
+/**
+ Maps a PNG file into memory for decoding with feed_mapped().
+
+ Use Fl_Image::fail() to check if the file could not be mapped; it
+ returns ERR_FILE_ACCESS in this case.
+
+ \param[in] filename	Name of PNG file to read
+ \return the size of the file in bytes, or -1 on error
+ */
+long Fl_Progressive_PNG_Image::map(const char *filename) {
+  unmap_();
+
+  int fd = fl_open(filename, O_RDONLY);
+  if (fd < 0) {
+    ld(ERR_FILE_ACCESS);
+    return -1;
+  }
+
+#ifdef WIN32
+  HANDLE file = (HANDLE)_get_osfhandle(fd);
+  LARGE_INTEGER size;
+
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+    // The view keeps a reference to the mapping object...
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping) {
+      map_ = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      if (map_) map_size_ = (size_t)size.QuadPart;
+      CloseHandle(mapping);
+    }
+  }
+  _close(fd);
+#else
+  struct stat st;
+
+  if (!fstat(fd, &st) && st.st_size > 0) {
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      map_      = (const unsigned char *)data;
+      map_size_ = (size_t)st.st_size;
+#  ifdef MADV_SEQUENTIAL
+      madvise(data, map_size_, MADV_SEQUENTIAL);
+#  endif // MADV_SEQUENTIAL
+    }
+  }
+  close(fd);
+#endif // WIN32
+
+  if (!map_) {
+    ld(ERR_FILE_ACCESS);
+    return -1;
+  }
+
+  map_pos_ = 0;
+  return (long)map_size_;
+}
+
+
+//
+// 'Fl_Progressive_PNG_Image::unmap_()' - Release the mapped file, if any.
+//
+
+void Fl_Progressive_PNG_Image::unmap_() {
+  if (!map_) return;
+
+#ifdef WIN32
+  UnmapViewOfFile((LPCVOID)map_);
+#else
+  munmap((void *)map_, map_size_);
+#endif // WIN32
+
+  map_      = 0;
+  map_size_ = 0;
+  map_pos_  = 0;
+}
+
+
 //
 // End of "$Id$".
 //
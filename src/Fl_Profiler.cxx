@@ -0,0 +1,606 @@
+//
+// "$Id$"
+//
+// Drawing profiler for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2016 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+// Fl::flush() calls fl_profile_frame() around the windows it draws and
+// fl_profile_begin() and fl_profile_end() around each window's flush(),
+// Fl_Group calls them around the draw() of each child. The graphics
+// driver calls are counted by a subclass of the display driver, which
+// replaces the display driver while the profiler is enabled.
+
+#include <FL/Fl.H>
+#include <FL/Fl_Profiler.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Widget.H>
+#include <FL/fl_draw.H>
+#include <FL/x.H>
+#include <FL/Fl_Device.H>
+#include <FL/filename.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include "flstring.h"
+#ifndef WIN32
+#  include <sys/time.h>
+#endif
+
+#define PROFILE_FRAMES	1024	// frames kept
+#define PROFILE_EVENTS	65536	// window and widget draws kept
+#define PROFILE_WIDGETS	4096	// widgets with statistics
+#define PROFILE_DEPTH	64	// nesting of draws
+
+int fl_profiling = 0;		// non-zero if the profiler is enabled
+
+static double clock_base;	// profile_clock() when first enabled
+static int clock_started;
+
+static Fl_Profiler::Frame frames_[PROFILE_FRAMES];
+static int frame_count;		// frames recorded since clear()
+static Fl_Profiler::Event *events_;
+static int event_count;		// events recorded since clear()
+static Fl_Profiler::Widget_Stats *stats_;
+static int stats_count;
+static int *stats_hash;		// indices into stats_, -1 if unused
+
+// the current frame:
+static int in_frame;
+static double frame_start;
+static int frame_windows;
+static unsigned long calls_[Fl_Profiler::CALL_TYPES];
+static struct { Fl_Widget *widget; double start; } stack_[PROFILE_DEPTH];
+static int stack_n, skipped, paused;
+
+static Fl_Double_Window *overlay = 0;
+
+static const char *call_names[Fl_Profiler::CALL_TYPES] = {
+  "rects", "lines", "points", "polygons", "paths", "arcs",
+  "vertices", "text", "measure", "images", "clips", "state"
+};
+
+// Returns the time in seconds since the profiler was enabled:
+static double profile_clock() {
+  double t;
+#ifdef WIN32
+  LARGE_INTEGER f, c;
+  QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&c);
+  t = (double)c.QuadPart / (double)f.QuadPart;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  t = tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+  if (!clock_started) {
+    clock_started = 1;
+    clock_base = t;
+  }
+  return t - clock_base;
+}
+
+static inline void count(int type) {
+  if (in_frame && !paused) calls_[type]++;
+}
+
+
+////////////////////////////////////////////////////////////////
+// Graphics driver that counts the calls
+
+#if defined(__APPLE__)
+typedef Fl_Quartz_Graphics_Driver Fl_Display_Driver_;
+#elif defined(WIN32)
+typedef Fl_GDI_Graphics_Driver Fl_Display_Driver_;
+#else
+typedef Fl_Xlib_Graphics_Driver Fl_Display_Driver_;
+#endif
+
+class Fl_Profiling_Driver : public Fl_Display_Driver_ {
+  typedef Fl_Display_Driver_ Base;
+  typedef Fl_Profiler P;
+protected:
+  void rect(int x, int y, int w, int h) {count(P::RECTS); Base::rect(x, y, w, h);}
+  void rectf(int x, int y, int w, int h) {count(P::RECTS); Base::rectf(x, y, w, h);}
+  void line_style(int style, int width, char* dashes) {count(P::STATE); Base::line_style(style, width, dashes);}
+  void xyline(int x, int y, int x1) {count(P::LINES); Base::xyline(x, y, x1);}
+  void xyline(int x, int y, int x1, int y2) {count(P::LINES); Base::xyline(x, y, x1, y2);}
+  void xyline(int x, int y, int x1, int y2, int x3) {count(P::LINES); Base::xyline(x, y, x1, y2, x3);}
+  void yxline(int x, int y, int y1) {count(P::LINES); Base::yxline(x, y, y1);}
+  void yxline(int x, int y, int y1, int x2) {count(P::LINES); Base::yxline(x, y, y1, x2);}
+  void yxline(int x, int y, int y1, int x2, int y3) {count(P::LINES); Base::yxline(x, y, y1, x2, y3);}
+  void line(int x, int y, int x1, int y1) {count(P::LINES); Base::line(x, y, x1, y1);}
+  void line(int x, int y, int x1, int y1, int x2, int y2) {count(P::LINES); Base::line(x, y, x1, y1, x2, y2);}
+  void draw(const char *str, int n, int x, int y) {count(P::TEXT); Base::draw(str, n, x, y);}
+  void draw(int angle, const char *str, int n, int x, int y) {count(P::TEXT); Base::draw(angle, str, n, x, y);}
+  void rtl_draw(const char *str, int n, int x, int y) {count(P::TEXT); Base::rtl_draw(str, n, x, y);}
+  void color(Fl_Color c) {count(P::STATE); Base::color(c);}
+  void color(uchar r, uchar g, uchar b) {count(P::STATE); Base::color(r, g, b);}
+  void point(int x, int y) {count(P::POINTS); Base::point(x, y);}
+  void loop(int x0, int y0, int x1, int y1, int x2, int y2) {count(P::LINES); Base::loop(x0, y0, x1, y1, x2, y2);}
+  void loop(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3) {count(P::LINES); Base::loop(x0, y0, x1, y1, x2, y2, x3, y3);}
+  void polygon(int x0, int y0, int x1, int y1, int x2, int y2) {count(P::POLYGONS); Base::polygon(x0, y0, x1, y1, x2, y2);}
+  void polygon(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3) {count(P::POLYGONS); Base::polygon(x0, y0, x1, y1, x2, y2, x3, y3);}
+  void begin_points() {count(P::PATHS); Base::begin_points();}
+  void begin_line() {count(P::PATHS); Base::begin_line();}
+  void begin_loop() {count(P::PATHS); Base::begin_loop();}
+  void begin_polygon() {count(P::PATHS); Base::begin_polygon();}
+  void vertex(double x, double y) {count(P::VERTICES); Base::vertex(x, y);}
+  void curve(double X0, double Y0, double X1, double Y1, double X2, double Y2, double X3, double Y3) {count(P::ARCS); Base::curve(X0, Y0, X1, Y1, X2, Y2, X3, Y3);}
+  void circle(double x, double y, double r) {count(P::ARCS); Base::circle(x, y, r);}
+  void arc(double x, double y, double r, double start, double end) {count(P::ARCS); Base::arc(x, y, r, start, end);}
+  void arc(int x, int y, int w, int h, double a1, double a2) {count(P::ARCS); Base::arc(x, y, w, h, a1, a2);}
+  void pie(int x, int y, int w, int h, double a1, double a2) {count(P::ARCS); Base::pie(x, y, w, h, a1, a2);}
+  void end_points() {count(P::PATHS); Base::end_points();}
+  void end_line() {count(P::PATHS); Base::end_line();}
+  void end_loop() {count(P::PATHS); Base::end_loop();}
+  void end_polygon() {count(P::POLYGONS); Base::end_polygon();}
+  void begin_complex_polygon() {count(P::PATHS); Base::begin_complex_polygon();}
+  void gap() {count(P::VERTICES); Base::gap();}
+  void end_complex_polygon() {count(P::POLYGONS); Base::end_complex_polygon();}
+  void transformed_vertex(double xf, double yf) {count(P::VERTICES); Base::transformed_vertex(xf, yf);}
+  void push_clip(int x, int y, int w, int h) {count(P::CLIPS); Base::push_clip(x, y, w, h);}
+  int clip_box(int x, int y, int w, int h, int &X, int &Y, int &W, int &H) {count(P::CLIPS); return Base::clip_box(x, y, w, h, X, Y, W, H);}
+  int not_clipped(int x, int y, int w, int h) {count(P::CLIPS); return Base::not_clipped(x, y, w, h);}
+  void push_no_clip() {count(P::CLIPS); Base::push_no_clip();}
+  void pop_clip() {count(P::CLIPS); Base::pop_clip();}
+  void draw_image(const uchar* buf, int X, int Y, int W, int H, int D, int L) {count(P::IMAGES); Base::draw_image(buf, X, Y, W, H, D, L);}
+  void draw_image_mono(const uchar* buf, int X, int Y, int W, int H, int D, int L) {count(P::IMAGES); Base::draw_image_mono(buf, X, Y, W, H, D, L);}
+  void draw_image(Fl_Draw_Image_Cb cb, void* data, int X, int Y, int W, int H, int D) {count(P::IMAGES); Base::draw_image(cb, data, X, Y, W, H, D);}
+  void draw_image_mono(Fl_Draw_Image_Cb cb, void* data, int X, int Y, int W, int H, int D) {count(P::IMAGES); Base::draw_image_mono(cb, data, X, Y, W, H, D);}
+  void draw(Fl_RGB_Image *rgb, int XP, int YP, int WP, int HP, int cx, int cy) {count(P::IMAGES); Base::draw(rgb, XP, YP, WP, HP, cx, cy);}
+  void draw(Fl_Pixmap *pxm, int XP, int YP, int WP, int HP, int cx, int cy) {count(P::IMAGES); Base::draw(pxm, XP, YP, WP, HP, cx, cy);}
+  void draw(Fl_Bitmap *bm, int XP, int YP, int WP, int HP, int cx, int cy) {count(P::IMAGES); Base::draw(bm, XP, YP, WP, HP, cx, cy);}
+public:
+  void font(Fl_Font face, Fl_Fontsize fsize) {count(P::STATE); Base::font(face, fsize);}
+  double width(const char *str, int n) {count(P::MEASURE); return Base::width(str, n);}
+  double width(unsigned int c) {count(P::MEASURE); return Base::width(c);}
+  void text_extents(const char *str, int n, int& dx, int& dy, int& w, int& h) {count(P::MEASURE); Base::text_extents(str, n, dx, dy, w, h);}
+  int height() {count(P::MEASURE); return Base::height();}
+  int descent() {count(P::MEASURE); return Base::descent();}
+};
+
+static Fl_Graphics_Driver *display_driver = 0;	// the original driver
+static Fl_Profiling_Driver *profiling_driver = 0;
+
+// Makes the display use the counting driver or the original driver.
+// The display must be the current surface:
+static void use_profiling_driver(int on) {
+  Fl_Display_Device *d = Fl_Display_Device::display_device();
+  Fl_Graphics_Driver *from = d->driver(), *to;
+  if (on) {
+    if (profiling_driver && from == profiling_driver) return;
+    if (!profiling_driver) profiling_driver = new Fl_Profiling_Driver;
+    display_driver = from;
+    to = profiling_driver;
+  } else {
+    if (!profiling_driver || from != profiling_driver) return;
+    to = display_driver;
+  }
+  d->driver(to);
+  d->set_current();
+  // the new driver continues with the font and color of the old one:
+  if (from->font_descriptor()) fl_font(from->font(), from->size());
+  fl_color(from->color());
+}
+
+
+////////////////////////////////////////////////////////////////
+// Recording
+
+// Returns the index of the statistics of a widget, -1 if the table is full:
+static int widget_index(Fl_Widget *w) {
+  if (!stats_) {
+    stats_ = (Fl_Profiler::Widget_Stats *)calloc(PROFILE_WIDGETS, sizeof(Fl_Profiler::Widget_Stats));
+    stats_hash = (int *)malloc(2 * PROFILE_WIDGETS * sizeof(int));
+    for (int i = 0; i < 2 * PROFILE_WIDGETS; i++) stats_hash[i] = -1;
+  }
+  unsigned h = (unsigned)(((fl_intptr_t)w >> 3) * 2654435761u) % (2 * PROFILE_WIDGETS);
+  while (stats_hash[h] >= 0) {
+    if (stats_[stats_hash[h]].widget == w) return stats_hash[h];
+    h = (h + 1) % (2 * PROFILE_WIDGETS);
+  }
+  if (stats_count >= PROFILE_WIDGETS) return -1;
+
+  Fl_Profiler::Widget_Stats *s = stats_ + stats_count;
+  memset(s, 0, sizeof(*s));
+  s->widget = w;
+  s->is_window = w->as_window() != 0;
+  if (w->label()) {
+    strlcpy(s->name, w->label(), sizeof(s->name));
+    for (char *p = s->name; *p; p++) if ((uchar)*p < ' ') *p = ' ';
+  }
+  stats_hash[h] = stats_count;
+  return stats_count++;
+}
+
+// Called by Fl::flush() before (begin != 0) and after drawing the windows:
+void fl_profile_frame(int begin) {
+  if (begin) {
+    if (Fl_Surface_Device::surface() == Fl_Display_Device::display_device())
+      use_profiling_driver(1);
+    in_frame = 1;
+    frame_start = profile_clock();
+    frame_windows = 0;
+    stack_n = skipped = paused = 0;
+    memset(calls_, 0, sizeof(calls_));
+    return;
+  }
+  if (!in_frame) return;
+  in_frame = 0;
+  if (!frame_windows) return;
+  Fl_Profiler::Frame *f = frames_ + frame_count % PROFILE_FRAMES;
+  f->number  = frame_count++;
+  f->start   = frame_start;
+  f->time    = profile_clock() - frame_start;
+  f->windows = frame_windows;
+  memcpy(f->calls, calls_, sizeof(calls_));
+}
+
+// Called before a window is flushed or a widget is drawn:
+void fl_profile_begin(Fl_Widget *w) {
+  if (!in_frame) return;
+  if (paused) {paused++; return;}
+  if (w == overlay) {paused = 1; return;}	// don't profile the profiler
+  if (stack_n >= PROFILE_DEPTH) {skipped++; return;}
+  if (!stack_n) frame_windows++;
+  stack_[stack_n].widget = w;
+  stack_[stack_n].start  = profile_clock();
+  stack_n++;
+}
+
+// Called after a window was flushed or a widget was drawn:
+void fl_profile_end(Fl_Widget *w) {
+  if (!in_frame) return;
+  if (paused) {paused--; return;}
+  if (skipped) {skipped--; return;}
+  if (!stack_n || stack_[stack_n-1].widget != w) return;
+  stack_n--;
+  double t = profile_clock() - stack_[stack_n].start;
+
+  int i = widget_index(w);
+  if (i < 0) return;
+  Fl_Profiler::Widget_Stats *s = stats_ + i;
+  s->count++;
+  s->total += t;
+  if (t > s->max) s->max = t;
+
+  if (!events_)
+    events_ = (Fl_Profiler::Event *)malloc(PROFILE_EVENTS * sizeof(Fl_Profiler::Event));
+  Fl_Profiler::Event *e = events_ + event_count % PROFILE_EVENTS;
+  e->frame  = frame_count;
+  e->widget = i;
+  e->depth  = stack_n;
+  e->start  = stack_[stack_n].start;
+  e->time   = t;
+  event_count++;
+}
+
+
+////////////////////////////////////////////////////////////////
+// Public interface
+
+/**
+  Enables or disables the profiler.
+  The recorded data is kept when the profiler is disabled.
+  \param[in] on non-zero to enable the profiler
+*/
+void Fl_Profiler::enable(int on) {
+  fl_profiling = on;
+  profile_clock();
+  if (!on && Fl_Surface_Device::surface() == Fl_Display_Device::display_device())
+    use_profiling_driver(0);
+}
+
+/** Returns non-zero if the profiler is enabled. */
+int Fl_Profiler::enabled() {
+  return fl_profiling;
+}
+
+/** Deletes all recorded frames, events, and widget statistics. */
+void Fl_Profiler::clear() {
+  frame_count = event_count = stats_count = 0;
+  if (stats_hash)
+    for (int i = 0; i < 2 * PROFILE_WIDGETS; i++) stats_hash[i] = -1;
+}
+
+/** Returns the number of frames that are kept, at most 1024. */
+int Fl_Profiler::frames() {
+  return frame_count < PROFILE_FRAMES ? frame_count : PROFILE_FRAMES;
+}
+
+/**
+  Returns a frame, 0 is the oldest frame that is kept and frames() - 1
+  the last one.
+*/
+const Fl_Profiler::Frame *Fl_Profiler::frame(int i) {
+  if (i < 0 || i >= frames()) return 0;
+  return frames_ + (frame_count - frames() + i) % PROFILE_FRAMES;
+}
+
+/** Returns the number of events that are kept, at most 65536. */
+int Fl_Profiler::events() {
+  return event_count < PROFILE_EVENTS ? event_count : PROFILE_EVENTS;
+}
+
+/**
+  Returns an event, 0 is the oldest event that is kept. The events of a
+  frame are in the order their draw ended, i.e. children come before
+  their parents.
+*/
+const Fl_Profiler::Event *Fl_Profiler::event(int i) {
+  if (i < 0 || i >= events()) return 0;
+  return events_ + (event_count - events() + i) % PROFILE_EVENTS;
+}
+
+/** Returns the number of widgets with statistics, at most 4096. */
+int Fl_Profiler::widgets() {
+  return stats_count;
+}
+
+/** Returns the statistics of a widget in the order they were first drawn. */
+const Fl_Profiler::Widget_Stats *Fl_Profiler::widget(int i) {
+  if (i < 0 || i >= stats_count) return 0;
+  return stats_ + i;
+}
+
+/** Returns the name of a Call_Type, e.g. "rects" for RECTS. */
+const char *Fl_Profiler::call_name(int type) {
+  if (type < 0 || type >= CALL_TYPES) return "";
+  return call_names[type];
+}
+
+// Returns a name for a widget in the output files:
+static const char *widget_name(int i, char *buf, int size) {
+  const Fl_Profiler::Widget_Stats *s = Fl_Profiler::widget(i);
+  if (!s) return "";
+  if (s->name[0]) return s->name;
+  snprintf(buf, size, "%s %p", s->is_window ? "window" : "widget", (void *)s->widget);
+  return buf;
+}
+
+/**
+  Writes the frames and events to a CSV file.
+
+  Each frame and each event is a row with the columns kind ("frame",
+  "window", or "widget"), frame, name, depth, start_ms, time_ms, and the
+  driver calls of frames by type.
+
+  \returns 0 on success, -1 if the file can't be written
+*/
+int Fl_Profiler::write_csv(const char *filename) {
+  FILE *fp = fl_fopen(filename, "w");
+  if (!fp) return -1;
+
+  int i, j;
+  char buf[64];
+  fputs("kind,frame,name,depth,start_ms,time_ms", fp);
+  for (j = 0; j < CALL_TYPES; j++) fprintf(fp, ",%s", call_names[j]);
+  fputs("\n", fp);
+
+  for (i = 0; i < frames(); i++) {
+    const Frame *f = frame(i);
+    fprintf(fp, "frame,%d,,,%.3f,%.3f", f->number, f->start * 1000.0, f->time * 1000.0);
+    for (j = 0; j < CALL_TYPES; j++) fprintf(fp, ",%lu", f->calls[j]);
+    fputs("\n", fp);
+  }
+
+  for (i = 0; i < events(); i++) {
+    const Event *e = event(i);
+    fprintf(fp, "%s,%d,\"", e->depth ? "widget" : "window", e->frame);
+    for (const char *p = widget_name(e->widget, buf, sizeof(buf)); *p; p++) {
+      if (*p == '\"') putc('\"', fp);
+      putc(*p, fp);
+    }
+    fprintf(fp, "\",%d,%.3f,%.3f", e->depth, e->start * 1000.0, e->time * 1000.0);
+    for (j = 0; j < CALL_TYPES; j++) fputs(",", fp);
+    fputs("\n", fp);
+  }
+
+  return fclose(fp) ? -1 : 0;
+}
+
+// Writes a JSON string:
+static void write_json_string(FILE *fp, const char *s) {
+  putc('\"', fp);
+  for (; *s; s++) {
+    if (*s == '\"' || *s == '\\') {putc('\\', fp); putc(*s, fp);}
+    else if ((uchar)*s < ' ') fprintf(fp, "\\u%04x", (uchar)*s);
+    else putc(*s, fp);
+  }
+  putc('\"', fp);
+}
+
+/**
+  Writes the frames and events to a file in the Chrome trace event
+  format, which can be loaded in chrome://tracing and similar viewers.
+
+  Frames, windows, and widgets are complete events ("ph":"X"), the
+  driver calls of each frame are counter events ("ph":"C").
+
+  \returns 0 on success, -1 if the file can't be written
+*/
+int Fl_Profiler::write_trace(const char *filename) {
+  FILE *fp = fl_fopen(filename, "w");
+  if (!fp) return -1;
+
+  int i, j;
+  char buf[64];
+  const char *sep = "\n";
+  fputs("{\"traceEvents\":[", fp);
+
+  for (i = 0; i < frames(); i++) {
+    const Frame *f = frame(i);
+    fprintf(fp, "%s{\"name\":\"frame %d\",\"cat\":\"frame\",\"ph\":\"X\","
+            "\"ts\":%.1f,\"dur\":%.1f,\"pid\":1,\"tid\":1}",
+            sep, f->number, f->start * 1e6, f->time * 1e6);
+    sep = ",\n";
+    fprintf(fp, "%s{\"name\":\"driver calls\",\"ph\":\"C\",\"ts\":%.1f,\"pid\":1,\"args\":{",
+            sep, f->start * 1e6);
+    for (j = 0; j < CALL_TYPES; j++)
+      fprintf(fp, "%s\"%s\":%lu", j ? "," : "", call_names[j], f->calls[j]);
+    fputs("}}", fp);
+  }
+
+  for (i = 0; i < events(); i++) {
+    const Event *e = event(i);
+    fprintf(fp, "%s{\"name\":", sep);
+    write_json_string(fp, widget_name(e->widget, buf, sizeof(buf)));
+    fprintf(fp, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.1f,\"dur\":%.1f,"
+            "\"pid\":1,\"tid\":1,\"args\":{\"frame\":%d,\"depth\":%d}}",
+            e->depth ? "widget" : "window", e->start * 1e6, e->time * 1e6,
+            e->frame, e->depth);
+    sep = ",\n";
+  }
+
+  fputs("\n],\"displayTimeUnit\":\"ms\"}\n", fp);
+  return fclose(fp) ? -1 : 0;
+}
+
+
+////////////////////////////////////////////////////////////////
+// Overlay window
+
+class Fl_Profiler_View : public Fl_Widget {
+public:
+  Fl_Profiler_View(int X, int Y, int W, int H) : Fl_Widget(X, Y, W, H) {}
+  void draw();
+};
+
+void Fl_Profiler_View::draw() {
+  char buf[256], name[64];
+  int i, j, n = Fl_Profiler::frames();
+  int X = x() + 6, Y = y() + 16, dy = 15;
+
+  fl_color(FL_BLACK);
+  fl_rectf(x(), y(), w(), h());
+  fl_font(FL_COURIER, 12);
+  fl_color(FL_GREEN);
+
+  if (!n) {
+    fl_draw(Fl_Profiler::enabled() ? "no frames yet" : "profiler disabled", X, Y);
+    return;
+  }
+
+  // frame times of the last 60 frames:
+  int first = n > 60 ? n - 60 : 0;
+  double total = 0.0, longest = 0.0;
+  for (i = first; i < n; i++) {
+    double t = Fl_Profiler::frame(i)->time;
+    total += t;
+    if (t > longest) longest = t;
+  }
+  const Fl_Profiler::Frame *last = Fl_Profiler::frame(n - 1);
+  double span = last->start - Fl_Profiler::frame(first)->start;
+  snprintf(buf, sizeof(buf), "frame %d: %.2f ms  avg %.2f  max %.2f",
+           last->number, last->time * 1000.0,
+           total * 1000.0 / (n - first), longest * 1000.0);
+  fl_draw(buf, X, Y); Y += dy;
+  snprintf(buf, sizeof(buf), "%.1f frames/s, %d window(s)",
+           span > 0.0 ? (n - first - 1) / span : 0.0, last->windows);
+  fl_draw(buf, X, Y); Y += dy;
+
+  // driver calls of the last frame, three per line:
+  for (j = 0; j < Fl_Profiler::CALL_TYPES; j += 3) {
+    buf[0] = 0;
+    for (i = j; i < j + 3 && i < Fl_Profiler::CALL_TYPES; i++) {
+      snprintf(name, sizeof(name), "%-9s%6lu  ", Fl_Profiler::call_name(i), last->calls[i]);
+      strlcat(buf, name, sizeof(buf));
+    }
+    fl_draw(buf, X, Y); Y += dy;
+  }
+
+  // the widgets with the longest total draw time:
+  fl_color(FL_YELLOW);
+  fl_draw("total ms   draws  widget", X, Y); Y += dy;
+  int shown[8], nshown = 0;
+  while (nshown < 8 && Y < y() + h()) {
+    int best = -1;
+    for (i = 0; i < Fl_Profiler::widgets(); i++) {
+      const Fl_Profiler::Widget_Stats *s = Fl_Profiler::widget(i);
+      if (s->is_window) continue;
+      for (j = 0; j < nshown && shown[j] != i; j++) {}
+      if (j < nshown) continue;
+      if (best < 0 || s->total > Fl_Profiler::widget(best)->total) best = i;
+    }
+    if (best < 0) break;
+    shown[nshown++] = best;
+    const Fl_Profiler::Widget_Stats *s = Fl_Profiler::widget(best);
+    snprintf(buf, sizeof(buf), "%8.2f %7lu  %s", s->total * 1000.0, s->count,
+             s->name[0] ? s->name : "(no label)");
+    fl_draw(buf, X, Y); Y += dy;
+  }
+}
+
+static Fl_Profiler_View *overlay_view = 0;
+
+static void overlay_timeout(void *) {
+  if (!overlay || !overlay->shown()) return;
+  overlay_view->redraw();
+  Fl::repeat_timeout(0.5, overlay_timeout);
+}
+
+/**
+  Shows a small window with the frame times, the driver calls of the
+  last frame, and the widgets with the longest total draw time. The
+  window is updated twice per second and is not profiled itself.
+*/
+void Fl_Profiler::show_overlay() {
+  if (!overlay) {
+    Fl_Group *current = Fl_Group::current();
+    Fl_Group::current(0);
+    overlay = new Fl_Double_Window(360, 260, "FLTK Profiler");
+    overlay_view = new Fl_Profiler_View(0, 0, 360, 260);
+    overlay->resizable(overlay_view);
+    overlay->end();
+    Fl_Group::current(current);
+  }
+  overlay->show();
+  Fl::remove_timeout(overlay_timeout);
+  Fl::add_timeout(0.5, overlay_timeout);
+}
+
+/** Hides the window of show_overlay(). */
+void Fl_Profiler::hide_overlay() {
+  Fl::remove_timeout(overlay_timeout);
+  if (overlay) overlay->hide();
+}
+
+
+////////////////////////////////////////////////////////////////
+// FLTK_PROFILE environment variable
+
+static char dump_file[FL_PATH_MAX];
+
+static void dump_at_exit() {
+  const char *ext = strrchr(dump_file, '.');
+  if (ext && !strcasecmp(ext, ".json")) Fl_Profiler::write_trace(dump_file);
+  else Fl_Profiler::write_csv(dump_file);
+}
+
+static int profile_from_environment() {
+  const char *e = fl_getenv("FLTK_PROFILE");
+  if (!e || !*e || !strcmp(e, "0")) return 0;
+  Fl_Profiler::enable(1);
+  if (strcmp(e, "1")) {
+    strlcpy(dump_file, e, sizeof(dump_file));
+    atexit(dump_at_exit);
+  }
+  return 1;
+}
+
+static int profile_environment = profile_from_environment();
+
+//
+// End of "$Id$".
+//
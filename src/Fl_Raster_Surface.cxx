@@ -0,0 +1,387 @@
+//
+// "$Id$"
+//
+// Software raster surface for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2016 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+// Nothing in here may use the graphics driver or other global state
+// except the (read-only) color map, since the methods are called by
+// worker threads while the main thread draws.
+
+#include <FL/Fl.H>
+#include <FL/Fl_Raster_Surface.H>
+#include <FL/Fl_Image.H>
+#include <FL/Fl_Bitmap.H>
+#include <FL/math.h>
+#include <stdlib.h>
+#include "flstring.h"
+
+/**
+  Creates a surface of w x h pixels filled with the color bg.
+*/
+Fl_Raster_Surface::Fl_Raster_Surface(int w, int h, Fl_Color bg) {
+  w_ = w > 0 ? w : 1;
+  h_ = h > 0 ? h : 1;
+  buffer_ = new uchar[w_ * h_ * 3];
+  ox_ = oy_ = 0;
+  clip_n_ = 0;
+  cx0_ = cy0_ = 0;
+  cx1_ = w_; cy1_ = h_;
+  color(bg);
+  uchar *p = buffer_;
+  for (int i = w_ * h_; i > 0; i--) {*p++ = r_; *p++ = g_; *p++ = b_;}
+  color(FL_BLACK);
+}
+
+/** Deletes the surface and its pixels. */
+Fl_Raster_Surface::~Fl_Raster_Surface() {
+  delete[] buffer_;
+}
+
+/**
+  Returns a new image with a copy of the pixels, which the caller must
+  delete. The image can be passed to another thread.
+*/
+Fl_RGB_Image *Fl_Raster_Surface::image() const {
+  uchar *copy = new uchar[w_ * h_ * 3];
+  memcpy(copy, buffer_, w_ * h_ * 3);
+  Fl_RGB_Image *img = new Fl_RGB_Image(copy, w_, h_, 3);
+  img->alloc_array = 1;
+  return img;
+}
+
+/** Sets the color for the following drawing, see fl_color(Fl_Color). */
+void Fl_Raster_Surface::color(Fl_Color c) {
+  Fl::get_color(c, r_, g_, b_);
+}
+
+/** Sets the color for the following drawing to an RGB color. */
+void Fl_Raster_Surface::color(uchar r, uchar g, uchar b) {
+  r_ = r; g_ = g; b_ = b;
+}
+
+////////////////////////////////////////////////////////////////
+// Clipping
+
+/**
+  Intersects the clip region with a rectangle and saves the previous
+  clip region, see fl_push_clip(). At most 10 regions can be saved.
+*/
+void Fl_Raster_Surface::push_clip(int x, int y, int w, int h) {
+  if (clip_n_ < 10) {
+    clip_stack_[clip_n_][0] = cx0_;
+    clip_stack_[clip_n_][1] = cy0_;
+    clip_stack_[clip_n_][2] = cx1_;
+    clip_stack_[clip_n_][3] = cy1_;
+  }
+  clip_n_++;
+  x += ox_; y += oy_;
+  if (x > cx0_) cx0_ = x;
+  if (y > cy0_) cy0_ = y;
+  if (x + w < cx1_) cx1_ = x + w;
+  if (y + h < cy1_) cy1_ = y + h;
+}
+
+/** Saves the clip region and draws to the whole surface, see fl_push_no_clip(). */
+void Fl_Raster_Surface::push_no_clip() {
+  push_clip(-ox_, -oy_, w_, h_);
+  cx0_ = cy0_ = 0;
+  cx1_ = w_; cy1_ = h_;
+}
+
+/** Restores the clip region saved by push_clip() or push_no_clip(). */
+void Fl_Raster_Surface::pop_clip() {
+  if (clip_n_ <= 0) return;
+  clip_n_--;
+  if (clip_n_ >= 10) return;
+  cx0_ = clip_stack_[clip_n_][0];
+  cy0_ = clip_stack_[clip_n_][1];
+  cx1_ = clip_stack_[clip_n_][2];
+  cy1_ = clip_stack_[clip_n_][3];
+}
+
+/** Returns non-zero if any part of the rectangle is inside the clip region. */
+int Fl_Raster_Surface::not_clipped(int x, int y, int w, int h) const {
+  x += ox_; y += oy_;
+  return w > 0 && h > 0 && x < cx1_ && y < cy1_ && x + w > cx0_ && y + h > cy0_;
+}
+
+////////////////////////////////////////////////////////////////
+// Primitives
+
+// Fills pixels x0 to x1 - 1 of row y, in surface coordinates:
+void Fl_Raster_Surface::span(int x0, int x1, int y) {
+  if (y < cy0_ || y >= cy1_) return;
+  if (x0 < cx0_) x0 = cx0_;
+  if (x1 > cx1_) x1 = cx1_;
+  if (x0 >= x1) return;
+  uchar *p = buffer_ + (y * w_ + x0) * 3;
+  for (int n = x1 - x0; n > 0; n--) {*p++ = r_; *p++ = g_; *p++ = b_;}
+}
+
+/** Sets a pixel to the current color. */
+void Fl_Raster_Surface::point(int x, int y) {
+  x += ox_; y += oy_;
+  span(x, x + 1, y);
+}
+
+/** Fills a rectangle, see fl_rectf(). */
+void Fl_Raster_Surface::rectf(int x, int y, int w, int h) {
+  x += ox_; y += oy_;
+  for (int i = 0; i < h; i++) span(x, x + w, y + i);
+}
+
+/** Draws a one pixel wide frame inside a rectangle, see fl_rect(). */
+void Fl_Raster_Surface::rect(int x, int y, int w, int h) {
+  if (w <= 0 || h <= 0) return;
+  xyline(x, y, x + w - 1);
+  xyline(x, y + h - 1, x + w - 1);
+  if (h > 2) {
+    yxline(x, y + 1, y + h - 2);
+    yxline(x + w - 1, y + 1, y + h - 2);
+  }
+}
+
+/** Draws a horizontal line from x, y to x1, y. */
+void Fl_Raster_Surface::xyline(int x, int y, int x1) {
+  if (x1 < x) {int t = x; x = x1; x1 = t;}
+  span(x + ox_, x1 + ox_ + 1, y + oy_);
+}
+
+/** Draws a vertical line from x, y to x, y1. */
+void Fl_Raster_Surface::yxline(int x, int y, int y1) {
+  if (y1 < y) {int t = y; y = y1; y1 = t;}
+  x += ox_;
+  for (; y <= y1; y++) span(x, x + 1, y + oy_);
+}
+
+/** Draws a one pixel wide line, including both end points. */
+void Fl_Raster_Surface::line(int x, int y, int x1, int y1) {
+  if (y == y1) {xyline(x, y, x1); return;}
+  if (x == x1) {yxline(x, y, y1); return;}
+  x += ox_; y += oy_; x1 += ox_; y1 += oy_;
+  // skip lines that are completely outside of the clip box:
+  if ((x < cx0_ && x1 < cx0_) || (x >= cx1_ && x1 >= cx1_) ||
+      (y < cy0_ && y1 < cy0_) || (y >= cy1_ && y1 >= cy1_)) return;
+  int dx = abs(x1 - x), sx = x < x1 ? 1 : -1;
+  int dy = -abs(y1 - y), sy = y < y1 ? 1 : -1;
+  int err = dx + dy;
+  for (;;) {
+    span(x, x + 1, y);
+    if (x == x1 && y == y1) break;
+    int e2 = 2 * err;
+    if (e2 >= dy) {err += dy; x += sx;}
+    if (e2 <= dx) {err += dx; y += sy;}
+  }
+}
+
+/** Draws the outline of a triangle. */
+void Fl_Raster_Surface::loop(int x0, int y0, int x1, int y1, int x2, int y2) {
+  line(x0, y0, x1, y1);
+  line(x1, y1, x2, y2);
+  line(x2, y2, x0, y0);
+}
+
+/** Draws the outline of a quadrilateral. */
+void Fl_Raster_Surface::loop(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3) {
+  line(x0, y0, x1, y1);
+  line(x1, y1, x2, y2);
+  line(x2, y2, x3, y3);
+  line(x3, y3, x0, y0);
+}
+
+// Fills a polygon in surface coordinates with the even-odd rule. Pixels
+// are filled if their center is inside the polygon:
+void Fl_Raster_Surface::fill(const double *x, const double *y, int n) {
+  if (n < 3) return;
+  double ymin = y[0], ymax = y[0];
+  int i;
+  for (i = 1; i < n; i++) {
+    if (y[i] < ymin) ymin = y[i];
+    if (y[i] > ymax) ymax = y[i];
+  }
+  int row0 = (int)ceil(ymin - 0.5), row1 = (int)ceil(ymax - 0.5);
+  if (row0 < cy0_) row0 = cy0_;
+  if (row1 > cy1_) row1 = cy1_;
+
+  double xbuf[64], *xs = n <= 64 ? xbuf : new double[n];
+  for (int row = row0; row < row1; row++) {
+    double yc = row + 0.5;
+    int m = 0;
+    for (i = 0; i < n; i++) {
+      int j = i + 1 < n ? i + 1 : 0;
+      if ((y[i] <= yc) == (y[j] <= yc)) continue;
+      double xc = x[i] + (yc - y[i]) * (x[j] - x[i]) / (y[j] - y[i]);
+      // insertion sort, there are only a few crossings per row:
+      int k = m++;
+      while (k > 0 && xs[k - 1] > xc) {xs[k] = xs[k - 1]; k--;}
+      xs[k] = xc;
+    }
+    for (i = 0; i + 1 < m; i += 2)
+      span((int)ceil(xs[i] - 0.5), (int)ceil(xs[i + 1] - 0.5), row);
+  }
+  if (xs != xbuf) delete[] xs;
+}
+
+/** Fills a triangle. */
+void Fl_Raster_Surface::polygon(int x0, int y0, int x1, int y1, int x2, int y2) {
+  int x[3] = {x0, x1, x2}, y[3] = {y0, y1, y2};
+  polygon(x, y, 3);
+}
+
+/** Fills a quadrilateral. */
+void Fl_Raster_Surface::polygon(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3) {
+  int x[4] = {x0, x1, x2, x3}, y[4] = {y0, y1, y2, y3};
+  polygon(x, y, 4);
+}
+
+/**
+  Fills a polygon with n vertices, which may be concave or intersect
+  itself. Areas that are enclosed an odd number of times are filled.
+*/
+void Fl_Raster_Surface::polygon(const int *x, const int *y, int n) {
+  if (n < 3) return;
+  double xbuf[32], ybuf[32];
+  double *xd = n <= 32 ? xbuf : new double[n];
+  double *yd = n <= 32 ? ybuf : new double[n];
+  for (int i = 0; i < n; i++) {
+    xd[i] = x[i] + ox_;
+    yd[i] = y[i] + oy_;
+  }
+  fill(xd, yd, n);
+  if (xd != xbuf) {delete[] xd; delete[] yd;}
+}
+
+// Returns the number of segments for an arc of an ellipse:
+int Fl_Raster_Surface::arc_segments(int w, int h, double a1, double a2) {
+  double r = (w > h ? w : h) / 2.0;
+  int n = (int)(fabs(a2 - a1) / 360.0 * 2.0 * M_PI * sqrt(r > 1.0 ? r : 1.0)) + 4;
+  return n > 1000 ? 1000 : n;
+}
+
+// Computes n points on the ellipse with the center x, y and the
+// radii w, h from the angle a1 to the angle a2 in degrees:
+void Fl_Raster_Surface::arc_points(double x, double y, double w, double h,
+                                   double a1, double a2, double *xp, double *yp, int n) {
+  for (int i = 0; i < n; i++) {
+    double a = (a1 + (a2 - a1) * i / (n - 1)) * (M_PI / 180.0);
+    xp[i] = x + cos(a) * w;
+    yp[i] = y - sin(a) * h;
+  }
+}
+
+/**
+  Draws an arc of the ellipse inside the rectangle from the angle a1 to
+  the angle a2 in degrees, counter-clockwise from 3 o'clock, see fl_arc().
+*/
+void Fl_Raster_Surface::arc(int x, int y, int w, int h, double a1, double a2) {
+  if (w <= 0 || h <= 0) return;
+  int n = arc_segments(w, h, a1, a2) + 1;
+  double *xp = new double[2 * n], *yp = xp + n;
+  arc_points(x + (w - 1) / 2.0, y + (h - 1) / 2.0, (w - 1) / 2.0, (h - 1) / 2.0,
+             a1, a2, xp, yp, n);
+  for (int i = 0; i + 1 < n; i++)
+    line((int)floor(xp[i] + 0.5), (int)floor(yp[i] + 0.5),
+         (int)floor(xp[i + 1] + 0.5), (int)floor(yp[i + 1] + 0.5));
+  delete[] xp;
+}
+
+/**
+  Fills a pie slice of the ellipse inside the rectangle from the angle
+  a1 to the angle a2 in degrees, see fl_pie(). The whole ellipse is
+  filled if the angles are 360 degrees apart.
+*/
+void Fl_Raster_Surface::pie(int x, int y, int w, int h, double a1, double a2) {
+  if (w <= 0 || h <= 0) return;
+  int full = fabs(a2 - a1) >= 360.0;
+  int n = arc_segments(w, h, a1, a2) + 1;
+  double *xp = new double[2 * (n + 1)], *yp = xp + n + 1;
+  double cx = x + ox_ + w / 2.0, cy = y + oy_ + h / 2.0;
+  arc_points(cx, cy, w / 2.0, h / 2.0, a1, a2, xp, yp, n);
+  if (!full) {xp[n] = cx; yp[n] = cy; n++;}
+  fill(xp, yp, n);
+  delete[] xp;
+}
+
+////////////////////////////////////////////////////////////////
+// Images
+
+/**
+  Draws image data with d bytes per pixel and l bytes per row (0 for
+  w * d), see fl_draw_image(). Pixels with 1 or 2 bytes are gray, with
+  3 or 4 bytes RGB. The second or fourth byte is alpha and is used to
+  blend the image with the surface.
+*/
+void Fl_Raster_Surface::draw_image(const uchar *buf, int x, int y, int w, int h, int d, int l) {
+  if (!buf || d < 1 || d > 4) return;
+  if (!l) l = w * d;
+  x += ox_; y += oy_;
+  int X = x > cx0_ ? x : cx0_, Y = y > cy0_ ? y : cy0_;
+  int R = x + w < cx1_ ? x + w : cx1_, B = y + h < cy1_ ? y + h : cy1_;
+  if (X >= R || Y >= B) return;
+  int alpha = (d == 2 || d == 4);
+  for (int row = Y; row < B; row++) {
+    const uchar *s = buf + (row - y) * l + (X - x) * d;
+    uchar *p = buffer_ + (row * w_ + X) * 3;
+    for (int col = X; col < R; col++, s += d, p += 3) {
+      uchar r, g, b;
+      if (d < 3) r = g = b = s[0];
+      else {r = s[0]; g = s[1]; b = s[2];}
+      if (alpha) {
+        unsigned a = s[d - 1];
+        if (!a) continue;
+        if (a < 255) {
+          r = (uchar)((r * a + p[0] * (255 - a)) / 255);
+          g = (uchar)((g * a + p[1] * (255 - a)) / 255);
+          b = (uchar)((b * a + p[2] * (255 - a)) / 255);
+        }
+      }
+      p[0] = r; p[1] = g; p[2] = b;
+    }
+  }
+}
+
+/** Draws an RGB image with its top left corner at x, y. */
+void Fl_Raster_Surface::draw(const Fl_RGB_Image *img, int x, int y) {
+  if (!img || !img->array) return;
+  draw_image(img->array, x, y, img->w(), img->h(), img->d(), img->ld());
+}
+
+/**
+  Draws the set bits of a bitmap in the current color with its top left
+  corner at x, y. Bitmaps of glyphs that were rendered in the main thread
+  can be used to draw text.
+*/
+void Fl_Raster_Surface::draw(const Fl_Bitmap *bm, int x, int y) {
+  if (!bm || !bm->array) return;
+  int bpl = (bm->w() + 7) / 8;
+  x += ox_; y += oy_;
+  for (int row = 0; row < bm->h(); row++) {
+    const uchar *s = bm->array + row * bpl;
+    int start = -1;
+    for (int col = 0; col <= bm->w(); col++) {
+      int set = col < bm->w() && (s[col >> 3] & (1 << (col & 7)));
+      if (set && start < 0) start = col;
+      else if (!set && start >= 0) {
+        span(x + start, x + col, y + row);
+        start = -1;
+      }
+    }
+  }
+}
+
+//
+// End of "$Id$".
+//
@@ -393,6 +393,18 @@ void Fl_Scroll::resize(int X, int Y, int W, int H) {
   relative to the origin of the Fl_Scroll (10,10), i.e. Fl_Box b3 will
   be visible in the top left corner of the scroll area.
 */
+// Clears the damage of a widget and of all its children:
+static void clear_damage_all(Fl_Widget *o) {
+  o->clear_damage();
+  Fl_Group *g = o->as_group();
+  if (!g) return;
+  Fl_Widget*const* a = g->array();
+  for (int i=g->children(); i--;) {
+    Fl_Widget* c = *a++;
+    if (c->damage() && !c->as_window()) clear_damage_all(c);
+  }
+}
+
 void Fl_Scroll::scroll_to(int X, int Y) {
   int dx = xposition_-X;
   int dy = yposition_-Y;
@@ -403,7 +415,12 @@ void Fl_Scroll::scroll_to(int X, int Y) {
   for (int i=children(); i--;) {
     Fl_Widget* o = *a++;
     if (o == &hscrollbar || o == &scrollbar) continue;
+    uchar d = o->damage();
     o->position(o->x()+dx, o->y()+dy);
+    // Moving a widget doesn't change its pixels, but some resize() methods
+    // call redraw(). Pixels of undamaged children are copied by fl_scroll(),
+    // so they are not drawn again unless they are scrolled into view:
+    if (!d && o->damage() && !o->as_window()) clear_damage_all(o);
   }
   if (parent() == (Fl_Group *)window() && Fl::scheme_bg_) damage(FL_DAMAGE_ALL);
   else damage(FL_DAMAGE_SCROLL);
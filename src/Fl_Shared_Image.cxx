@@ -39,14 +39,108 @@ int	Fl_Shared_Image::alloc_images_ = 0;	// Allocated shared images
 Fl_Shared_Handler *Fl_Shared_Image::handlers_ = 0;// Additional format handlers
 int	Fl_Shared_Image::num_handlers_ = 0;	// Number of format handlers
 int	Fl_Shared_Image::alloc_handlers_ = 0;	// Allocated format handlers
+int	Fl_Shared_Image::reduce_w_ = 0;		// Size requested by get()
+int	Fl_Shared_Image::reduce_h_ = 0;
+int	Fl_Shared_Image::reduced_ = 0;		// Loader decoded a reduced image
 
 
 //
-// Typedef the C API sort function type the only way I know how...
+// Hash index of the shared images...
 //
+// The images_ array is kept unsorted (so that add() and release() are O(1))
+// and every image is also entered into an open-addressing hash table with
+// linear probing.  Slots are hashed on the image name only, so that the
+// "original image" lookup of find(name) and images resized by scale()
+// are still found; the width and height are checked while probing.
+//
+
+struct Fl_Shared_Image_Slot {
+  Fl_Shared_Image	*image;		// Image in this slot or 0 if empty
+  unsigned		hash;		// Hash of the image name
+  int			index;		// Index of the image in images_
+};
+
+static Fl_Shared_Image_Slot *slots_ = 0;	// Hash table
+static unsigned	alloc_slots_ = 0;		// Allocated slots (power of 2)
+
+
+//
+// 'hash_name()' - Compute the FNV-1a hash of an image name.
+//
+
+static unsigned hash_name(const char *n) {
+  unsigned h = 2166136261U;
+
+  while (*n) {
+    h ^= (uchar)*n++;
+    h *= 16777619U;
+  }
+
+  return h;
+}
+
+
+//
+// 'insert_slot()' - Insert an image into the hash table (no resize).
+//
+
+static void insert_slot(Fl_Shared_Image *img, unsigned h, int index) {
+  unsigned mask = alloc_slots_ - 1;
+  unsigned i    = h & mask;
+
+  while (slots_[i].image) i = (i + 1) & mask;
+
+  slots_[i].image = img;
+  slots_[i].hash  = h;
+  slots_[i].index = index;
+}
+
+
+//
+// 'find_slot()' - Find the hash table slot that holds an image.
+//
+
+static Fl_Shared_Image_Slot *find_slot(Fl_Shared_Image *img) {
+  if (!alloc_slots_) return 0;
+
+  unsigned mask = alloc_slots_ - 1;
+  unsigned i    = hash_name(img->name()) & mask;
+
+  for (; slots_[i].image; i = (i + 1) & mask)
+    if (slots_[i].image == img) return slots_ + i;
+
+  return 0;
+}
+
+
+//
+// 'remove_slot()' - Remove a slot, shifting later entries of its probe
+//                   sequence back so that no tombstones are needed.
+//
+
+static void remove_slot(Fl_Shared_Image_Slot *slot) {
+  unsigned mask = alloc_slots_ - 1;
+  unsigned i    = (unsigned)(slot - slots_);
+  unsigned j    = i;
+
+  for (;;) {
+    slots_[i].image = 0;
 
-extern "C" {
-  typedef int (*compare_func_t)(const void *, const void *);
+    for (;;) {
+      j = (j + 1) & mask;
+      if (!slots_[j].image) return;
+
+      // Move slot j into the hole at i unless its home lies cyclically
+      // in (i, j]...
+      unsigned home = slots_[j].hash & mask;
+      if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+        continue;
+
+      slots_[i] = slots_[j];
+      i = j;
+      break;
+    }
+  }
 }
 
 
@@ -131,8 +225,10 @@ Fl_Shared_Image::add() {
   Fl_Shared_Image	**temp;		// New image pointer array...
 
   if (num_images_ >= alloc_images_) {
-    // Allocate more memory...
-    temp = new Fl_Shared_Image *[alloc_images_ + 32];
+    // Allocate more memory, doubling the array each time...
+    int alloc = alloc_images_ ? 2 * alloc_images_ : 32;
+
+    temp = new Fl_Shared_Image *[alloc];
 
     if (alloc_images_) {
       memcpy(temp, images_, alloc_images_ * sizeof(Fl_Shared_Image *));
@@ -141,16 +237,28 @@ Fl_Shared_Image::add() {
     }
 
     images_       = temp;
-    alloc_images_ += 32;
+    alloc_images_ = alloc;
   }
 
-  images_[num_images_] = this;
-  num_images_ ++;
+  if (2 * (unsigned)(num_images_ + 1) > alloc_slots_) {
+    // Grow the hash table to keep the load factor below 1/2...
+    Fl_Shared_Image_Slot *old_slots = slots_;
+    unsigned		 old_alloc = alloc_slots_;
+
+    alloc_slots_ = old_alloc ? 2 * old_alloc : 64;
+    slots_       = new Fl_Shared_Image_Slot[alloc_slots_];
+    memset(slots_, 0, alloc_slots_ * sizeof(Fl_Shared_Image_Slot));
 
-  if (num_images_ > 1) {
-    qsort(images_, num_images_, sizeof(Fl_Shared_Image *),
-          (compare_func_t)compare);
+    for (unsigned i = 0; i < old_alloc; i ++)
+      if (old_slots[i].image)
+        insert_slot(old_slots[i].image, old_slots[i].hash, old_slots[i].index);
+
+    delete[] old_slots;
   }
+
+  images_[num_images_] = this;
+  insert_slot(this, hash_name(name_), num_images_);
+  num_images_ ++;
 }
 
 
@@ -189,22 +297,25 @@ Fl_Shared_Image::~Fl_Shared_Image() {
   In the latter case, it will reorganize the shared image array so that no hole will occur.
 */
 void Fl_Shared_Image::release() {
-  int	i;	// Looping var...
+  int	i;	// Index in the image array...
 
   refcount_ --;
   if (refcount_ > 0) return;
 
-  for (i = 0; i < num_images_; i ++)
-    if (images_[i] == this) {
-      num_images_ --;
+  Fl_Shared_Image_Slot *slot = find_slot(this);
 
-      if (i < num_images_) {
-        memmove(images_ + i, images_ + i + 1,
-               (num_images_ - i) * sizeof(Fl_Shared_Image *));
-      }
+  if (slot) {
+    // Fill the hole in images_ with the last image...
+    i = slot->index;
+    remove_slot(slot);
 
-      break;
+    num_images_ --;
+
+    if (i < num_images_) {
+      images_[i] = images_[num_images_];
+      find_slot(images_[i])->index = i;
     }
+  }
 
   delete this;
 
@@ -213,6 +324,11 @@ void Fl_Shared_Image::release() {
 
     images_       = 0;
     alloc_images_ = 0;
+
+    delete[] slots_;
+
+    slots_       = 0;
+    alloc_slots_ = 0;
   }
 }
 
@@ -424,25 +540,20 @@ void Fl_Shared_Image::uncache()
 
 /** Finds a shared image from its named and size specifications */
 Fl_Shared_Image* Fl_Shared_Image::find(const char *n, int W, int H) {
-  Fl_Shared_Image	*key,		// Image key
-			**match;	// Matching image
+  if (!num_images_ || !n) return 0;
 
-  if (num_images_) {
-    key = new Fl_Shared_Image();
-    key->name_ = new char[strlen(n) + 1];
-    strcpy((char *)key->name_, n);
-    key->w(W);
-    key->h(H);
+  unsigned h    = hash_name(n);
+  unsigned mask = alloc_slots_ - 1;
 
-    match = (Fl_Shared_Image **)bsearch(&key, images_, num_images_,
-                                        sizeof(Fl_Shared_Image *),
-                                        (compare_func_t)compare);
+  for (unsigned i = h & mask; slots_[i].image; i = (i + 1) & mask) {
+    Fl_Shared_Image *img = slots_[i].image;
 
-    delete key;
+    if (slots_[i].hash != h || strcmp(img->name(), n)) continue;
 
-    if (match) {
-      (*match)->refcount_ ++;
-      return *match;
+    // Same rules as compare(): a zero width matches the original image...
+    if ((W == 0 && img->original_) || (img->w() == W && img->h() == H)) {
+      img->refcount_ ++;
+      return img;
     }
   }
 
@@ -459,6 +570,11 @@ Fl_Shared_Image* Fl_Shared_Image::find(const char *n, int W, int H) {
  by a new image from the n filename of the proper dimension.
  If n is not a valid image filename, then get() will return NULL.
  
+ If the image is not cached yet and \p W and \p H are given, image formats
+ that support it (JPEG) are decoded at a reduced resolution that is just
+ large enough for the requested size. In this case only the image of the
+ requested size is cached, not the original image.
+
  Shared JPEG and PNG images can also be created from memory by using their 
  named memory access constructor.
  
@@ -476,13 +592,34 @@ Fl_Shared_Image* Fl_Shared_Image::get(const char *n, int W, int H) {
   if ((temp = find(n, W, H)) != NULL) return temp;
 
   if ((temp = find(n)) == NULL) {
+    // Let loaders that can (JPEG) decode at a reduced resolution...
+    reduce_w_ = (W && H) ? W : 0;
+    reduce_h_ = (W && H) ? H : 0;
+    reduced_  = 0;
+
     temp = new Fl_Shared_Image(n);
 
+    reduce_w_ = reduce_h_ = 0;
+
     if (!temp->image_) {
       delete temp;
       return NULL;
     }
 
+    if (reduced_) {
+      // Not the original image, so only cache the requested size...
+      temp->original_ = 0;
+
+      if (temp->w() != W || temp->h() != H) {
+        Fl_Shared_Image *reduced = (Fl_Shared_Image *)temp->copy(W, H);
+        delete temp;
+        temp = reduced;
+      }
+
+      temp->add();
+      return temp;
+    }
+
     temp->add();
   }
 
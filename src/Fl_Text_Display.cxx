@@ -82,6 +82,41 @@ static int scroll_amount = 0;
 static int scroll_y = 0;
 static int scroll_x = 0;
 
+/* Scrolling that was not drawn yet. The text area is scrolled by copying
+ its pixels with fl_scroll(), so only the exposed lines are drawn. */
+struct Fl_Text_Scroll {
+  Fl_Text_Display *display;
+  int lines;			// vertical scroll distance in lines
+  int dx;			// horizontal scroll distance in pixels
+};
+#define PENDING_SCROLLS 8
+static Fl_Text_Scroll pending_scrolls[PENDING_SCROLLS];
+
+static Fl_Text_Scroll *find_scroll(const Fl_Text_Display *d) {
+  for (int i = 0; i < PENDING_SCROLLS; i++)
+    if (pending_scrolls[i].display == d) return pending_scrolls + i;
+  return 0;
+}
+
+/* Areas of the text area that fl_scroll() could not copy. */
+#define EXPOSED_AREAS 8
+static int exposed_n;
+static int exposed_xywh[EXPOSED_AREAS][4];
+
+static void collect_exposed(void *, int X, int Y, int W, int H) {
+  if (W <= 0 || H <= 0) return;
+  if (exposed_n < EXPOSED_AREAS) {
+    int *r = exposed_xywh[exposed_n++];
+    r[0] = X; r[1] = Y; r[2] = W; r[3] = H;
+    return;
+  }
+  // too many areas, merge with the last one:
+  int *r = exposed_xywh[EXPOSED_AREAS-1];
+  int R = max(r[0]+r[2], X+W), B = max(r[1]+r[3], Y+H);
+  r[0] = min(r[0], X); r[1] = min(r[1], Y);
+  r[2] = R - r[0]; r[3] = B - r[1];
+}
+
 // CET - FIXME
 #define TMPFONTWIDTH 6
 
@@ -184,6 +219,8 @@ Fl_Text_Display::Fl_Text_Display(int X, int Y, int W, int H, const char* l)
  entity and is not freed, nor are the style buffer or style table.
  */
 Fl_Text_Display::~Fl_Text_Display() {
+  Fl_Text_Scroll *pending = find_scroll(this);
+  if (pending) pending->display = 0;
   if (scroll_direction) {
     Fl::remove_timeout(scroll_timer_cb, this);
     scroll_direction = 0;
@@ -500,6 +537,8 @@ void Fl_Text_Display::resize(int X, int Y, int W, int H) {
   unsigned int vscrollbarvisible = mVScrollBar->visible();
 
   int oldTAWidth = text_area.w;
+  int oldTAX = text_area.x, oldTAY = text_area.y, oldTAH = text_area.h;
+  int oldMaxsize = mMaxsize;
 
   X += Fl::box_dx(box());
   Y += Fl::box_dy(box());
@@ -705,7 +744,10 @@ void Fl_Text_Display::resize(int X, int Y, int W, int H) {
   mHorizOffsetHint = mHorizOffset;
   display_insert_position_hint = 0;
 
-  if (mContinuousWrap ||
+  // scroll() calls resize() too, don't redraw if only the text scrolled:
+  if (text_area.x != oldTAX || text_area.y != oldTAY ||
+      text_area.w != oldTAWidth || text_area.h != oldTAH ||
+      mMaxsize != oldMaxsize ||
       hscrollbarvisible != mHScrollBar->visible() ||
       vscrollbarvisible != mVScrollBar->visible())
     redraw();
@@ -970,6 +1012,8 @@ void Fl_Text_Display::wrap_mode(int wrap, int wrapMargin) {
   }
 
   resize(x(), y(), w(), h());
+  // resize() only redraws if the text area changed, but all lines may move
+  redraw();
 }
 
 
@@ -2854,6 +2898,9 @@ int Fl_Text_Display::scroll_(int topLineNum, int horizOffset) {
   if (mHorizOffset == horizOffset && mTopLineNum == topLineNum)
     return 0;
 
+  int lines = mTopLineNum - topLineNum;
+  int dx = mHorizOffset - horizOffset;
+
   /* If the vertical scroll position has changed, update the line
    starts array and related counters in the text display */
   offset_line_starts(topLineNum);
@@ -2861,6 +2908,21 @@ int Fl_Text_Display::scroll_(int topLineNum, int horizOffset) {
   /* Just setting mHorizOffset is enough information for redisplay */
   mHorizOffset = horizOffset;
 
+  // copy the text that stays visible unless all text is redrawn anyway
+  if (!(damage() & (FL_DAMAGE_ALL | FL_DAMAGE_EXPOSE))) {
+    Fl_Text_Scroll *pending = find_scroll(this);
+    if (!pending && (pending = find_scroll(0)) != 0) {
+      pending->display = this;
+      pending->lines = pending->dx = 0;
+    }
+    if (pending) {
+      pending->lines += lines;
+      pending->dx += dx;
+      damage(FL_DAMAGE_SCROLL);
+      return 1;
+    }
+  }
+
   // redraw all text
   damage(FL_DAMAGE_EXPOSE);
   return 1;
@@ -3746,6 +3808,24 @@ void Fl_Text_Display::draw(void) {
   update_child(*mVScrollBar);
   update_child(*mHScrollBar);
 
+  // copy the pixels of scrolled text if it wasn't redrawn since then
+  Fl_Text_Scroll *pending = find_scroll(this);
+  if (pending) {
+    pending->display = 0;
+    if (!(damage() & (FL_DAMAGE_ALL | FL_DAMAGE_EXPOSE))) {
+      if (Fl_Surface_Device::surface() != Fl_Display_Device::display_device()) {
+        clear_damage(damage() | FL_DAMAGE_EXPOSE);
+      } else {
+        exposed_n = 0;
+        fl_scroll(text_area.x, text_area.y, text_area.w, text_area.h,
+                  pending->dx, pending->lines * mMaxsize, collect_exposed, 0);
+        for (int i = 0; i < exposed_n; i++)
+          draw_text(exposed_xywh[i][0], exposed_xywh[i][1],
+                    exposed_xywh[i][2], exposed_xywh[i][3]);
+      }
+    }
+  }
+
   // draw all of the text
   if (damage() & (FL_DAMAGE_ALL | FL_DAMAGE_EXPOSE)) {
     //printf("drawing all text\n");
@@ -147,8 +147,11 @@ Fl_Widget::Fl_Widget(int X, int Y, int W, int H, const char* L) {
   }
 }
 
+extern void fl_group_index_changed(Fl_Group*); // in Fl_Group.cxx
+
 void Fl_Widget::resize(int X, int Y, int W, int H) {
   x_ = X; y_ = Y; w_ = W; h_ = H;
+  if (parent_ && parent_->spatial_index()) fl_group_index_changed(parent_);
 }
 
 // this is useful for parent widgets to call to resize children:
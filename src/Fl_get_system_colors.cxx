@@ -263,6 +263,8 @@ Fl_Image	*Fl::scheme_bg_ = (Fl_Image *)0;    // current background image for the
 
 static Fl_Pixmap	tile(tile_xpm);
 
+extern void fl_group_cache_changed(); // in Fl_Group.cxx
+
 /**
     Sets the current widget scheme. NULL will use the scheme defined
     in the FLTK_SCHEME environment variable or the scheme resource
@@ -446,6 +448,9 @@ int Fl::reload_scheme() {
   // See also STR #3075.
   // AlbrechtS, 01 Mar 2015
 
+  // Cached groups must be drawn with the new boxtypes...
+  fl_group_cache_changed();
+
   for (win = first_window(); win; win = next_window(win)) {
     win->labeltype(scheme_bg_ ? FL_NORMAL_LABEL : FL_NO_LABEL);
     win->align(FL_ALIGN_CENTER | FL_ALIGN_INSIDE | FL_ALIGN_CLIP);
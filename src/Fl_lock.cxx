@@ -18,9 +18,13 @@
 
 
 #include <FL/Fl.H>
+#include <FL/Fl_Widget.H>
 #include <config.h>
 
 #include <stdlib.h>
+#ifdef HAVE_PTHREAD
+#  include <sched.h>
+#endif
 
 /*
    From Bill:
@@ -66,59 +70,177 @@ int Fl::awake_ring_head_;
 int Fl::awake_ring_tail_;
 #endif
 
-static const int AWAKE_RING_SIZE = 1024;
+/*
+   The awake handlers are kept in a lock-free queue of nodes, which the
+   threads add to and only the main thread removes from (D. Vyukov's
+   intrusive multi-producer single-consumer queue). Adding a node takes
+   one atomic exchange, so threads don't wait for each other or for the
+   main thread, and the queue is only limited by memory.
+
+   Threads wake up the main thread only if it was not woken up already
+   since it last ran the handlers, so a burst of awake(cb, data) calls
+   costs a single write to the pipe (or PostThreadMessage()).
+
+   awake_ring_head_ and awake_ring_tail_ count the handlers added and
+   removed; awake_ring_, awake_data_, and awake_ring_size_ are unused.
+*/
+
+struct Fl_Awake_Node {
+  Fl_Awake_Node *volatile next;
+  Fl_Awake_Handler func;
+  void *data;
+};
+
+static Fl_Awake_Node awake_stub;			// always in the queue
+static Fl_Awake_Node *volatile awake_last = &awake_stub;	// threads add here
+static Fl_Awake_Node *awake_first = &awake_stub;		// main thread removes here
+static volatile int awake_pending;	// main thread was woken up
+static volatile int awake_wakeups;	// number of wake ups by awake(cb, data)
+static int awake_max_depth;		// largest number of handlers run at once
+static unsigned long awake_handled;	// number of handlers run
+
+#if defined(WIN32)
+#  include <windows.h>
+static inline void *atomic_exchange(void *volatile *p, void *v) {
+  return InterlockedExchangePointer((PVOID volatile *)p, v);
+}
+static inline int atomic_exchange(volatile int *p, int v) {
+  return (int)InterlockedExchange((LONG volatile *)p, v);
+}
+static inline void atomic_add(volatile int *p, int v) {
+  InterlockedExchangeAdd((LONG volatile *)p, v);
+}
+static inline void *atomic_load(void *volatile *p) {
+  MemoryBarrier(); void *v = *p; MemoryBarrier(); return v;
+}
+static inline void atomic_store(void *volatile *p, void *v) {
+  InterlockedExchangePointer((PVOID volatile *)p, v);
+}
+#elif defined(__ATOMIC_SEQ_CST)
+static inline void *atomic_exchange(void *volatile *p, void *v) {
+  return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);
+}
+static inline int atomic_exchange(volatile int *p, int v) {
+  return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);
+}
+static inline void atomic_add(volatile int *p, int v) {
+  __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST);
+}
+static inline void *atomic_load(void *volatile *p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+static inline void atomic_store(void *volatile *p, void *v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+#elif defined(__GNUC__)
+static inline void *atomic_exchange(void *volatile *p, void *v) {
+  __sync_synchronize(); return __sync_lock_test_and_set(p, v);
+}
+static inline int atomic_exchange(volatile int *p, int v) {
+  __sync_synchronize(); return __sync_lock_test_and_set(p, v);
+}
+static inline void atomic_add(volatile int *p, int v) {
+  __sync_fetch_and_add(p, v);
+}
+static inline void *atomic_load(void *volatile *p) {
+  void *v = *p; __sync_synchronize(); return v;
+}
+static inline void atomic_store(void *volatile *p, void *v) {
+  __sync_synchronize(); *p = v;
+}
+#else
+// no atomic operations, use a mutex:
+#  define AWAKE_USE_MUTEX 1
 static void lock_ring();
 static void unlock_ring();
+static inline void *atomic_exchange(void *volatile *p, void *v) {
+  lock_ring(); void *o = *p; *p = v; unlock_ring(); return o;
+}
+static inline int atomic_exchange(volatile int *p, int v) {
+  lock_ring(); int o = *p; *p = v; unlock_ring(); return o;
+}
+static inline void atomic_add(volatile int *p, int v) {
+  lock_ring(); *p += v; unlock_ring();
+}
+static inline void *atomic_load(void *volatile *p) {
+  lock_ring(); void *v = *p; unlock_ring(); return v;
+}
+static inline void atomic_store(void *volatile *p, void *v) {
+  lock_ring(); *p = v; unlock_ring();
+}
+#endif
 
-/** Adds an awake handler for use in awake(). */
-int Fl::add_awake_handler_(Fl_Awake_Handler func, void *data)
-{
-  int ret = 0;
-  lock_ring();
-  if (!awake_ring_) {
-    awake_ring_size_ = AWAKE_RING_SIZE;
-    awake_ring_ = (Fl_Awake_Handler*)malloc(awake_ring_size_*sizeof(Fl_Awake_Handler));
-    awake_data_ = (void**)malloc(awake_ring_size_*sizeof(void*));
-    // explicitly initialize the head and tail indices
-    awake_ring_head_= awake_ring_tail_ = 0;
+static void push_node(Fl_Awake_Node *n) {
+  n->next = 0;
+  Fl_Awake_Node *prev =
+    (Fl_Awake_Node *)atomic_exchange((void *volatile *)&awake_last, n);
+  // until this store, the main thread sees the queue end at prev:
+  atomic_store((void *volatile *)&prev->next, n);
+}
+
+// Removes the first node, returns NULL if the queue is empty or if a
+// thread is still adding the next node:
+static Fl_Awake_Node *pop_node() {
+  Fl_Awake_Node *first = awake_first;
+  Fl_Awake_Node *next = (Fl_Awake_Node *)atomic_load((void *volatile *)&first->next);
+  if (first == &awake_stub) {
+    if (!next) return 0;
+    awake_first = first = next;
+    next = (Fl_Awake_Node *)atomic_load((void *volatile *)&first->next);
   }
-  // The next head index we will want (not the current index):
-  // We use this to check if the ring-buffer is full or not
-  // (and to update awake_ring_head_ if we do use the current index.)
-  int next_head = awake_ring_head_ + 1;
-  if (next_head >= awake_ring_size_) {
-    next_head = 0;
+  if (next) {
+    awake_first = next;
+    return first;
   }
-  // check that the ring buffer is not full, and that it exists
-  if ((!awake_ring_) || (next_head == awake_ring_tail_)) {
-    // ring is non-existent or full. Return -1 as an error indicator.
-    ret = -1;
-  } else {
-    awake_ring_[awake_ring_head_] = func;
-    awake_data_[awake_ring_head_] = data;
-    awake_ring_head_ = next_head;
+  if (first != atomic_load((void *volatile *)&awake_last)) return 0;
+  // first is the only node, put the stub behind it so it can be removed:
+  push_node(&awake_stub);
+  next = (Fl_Awake_Node *)atomic_load((void *volatile *)&first->next);
+  if (next) {
+    awake_first = next;
+    return first;
   }
-  unlock_ring();
-  return ret;
+  return 0;
+}
+
+/** Adds an awake handler for use in awake(). */
+int Fl::add_awake_handler_(Fl_Awake_Handler func, void *data)
+{
+  Fl_Awake_Node *n = (Fl_Awake_Node *)malloc(sizeof(Fl_Awake_Node));
+  if (!n) return -1;
+  n->func = func;
+  n->data = data;
+  push_node(n);
+  atomic_add(&awake_ring_head_, 1);
+  return 0;
 }
 
 /** Gets the last stored awake handler for use in awake(). */
 int Fl::get_awake_handler_(Fl_Awake_Handler &func, void *&data)
 {
-  int ret = 0;
-  lock_ring();
-  if ((!awake_ring_) || (awake_ring_head_ == awake_ring_tail_)) {
-    ret = -1;
-  } else {
-    func = awake_ring_[awake_ring_tail_];
-    data = awake_data_[awake_ring_tail_];
-    ++awake_ring_tail_;
-    if (awake_ring_tail_ >= awake_ring_size_) {
-      awake_ring_tail_ = 0;
-    }
+  Fl_Awake_Node *n = pop_node();
+  if (!n) return -1;
+  func = n->func;
+  data = n->data;
+  free(n);
+  awake_ring_tail_++;
+  return 0;
+}
+
+// Runs the awake handlers, called by the main thread when it was woken
+// up. Only the handlers that were added before are run, handlers that
+// are added meanwhile wake up the main thread again:
+void fl_run_awake_handlers() {
+  atomic_exchange(&awake_pending, 0);
+  int n;
+  Fl::awake_stats(&n);
+  if (n > awake_max_depth) awake_max_depth = n;
+  Fl_Awake_Handler func;
+  void *data;
+  while (n-- > 0 && Fl::get_awake_handler_(func, data) == 0) {
+    awake_handled++;
+    (*func)(data);
   }
-  unlock_ring();
-  return ret;
 }
 
 /**
@@ -126,17 +248,159 @@ int Fl::get_awake_handler_(Fl_Awake_Handler &func, void *&data)
  Registers a function that will be 
  called by the main thread during the next message handling cycle. 
  Returns 0 if the callback function was registered, 
- and -1 if registration failed. Over a thousand awake callbacks can be
- registered simultaneously.
+ and -1 if registration failed. There is no limit on the number of
+ awake callbacks that can be registered, and the callbacks are called
+ in the order they were registered.
+
+ The main thread is woken up only once for all callbacks that are
+ registered before it calls them.
  
  \see Fl::awake(void* message=0)
+ \see Fl::awake_stats()
 */
 int Fl::awake(Fl_Awake_Handler func, void *data) {
   int ret = add_awake_handler_(func, data);
-  Fl::awake();
+  if (!atomic_exchange(&awake_pending, 1)) {
+    atomic_add(&awake_wakeups, 1);
+    Fl::awake();
+  }
   return ret;
 }
 
+/**
+ Returns statistics of the queue of awake(Fl_Awake_Handler, void*) callbacks.
+ All values can be NULL.
+ \param[out] depth number of callbacks in the queue
+ \param[out] max_depth largest number of callbacks that were run at once
+ \param[out] handled number of callbacks that were run
+ \param[out] wakeups number of times the main thread was woken up for them
+ \note The values are read without synchronization.
+*/
+void Fl::awake_stats(int *depth, int *max_depth, unsigned long *handled, int *wakeups) {
+  if (depth) *depth = awake_ring_head_ - awake_ring_tail_;
+  if (max_depth) *max_depth = awake_max_depth;
+  if (handled) *handled = awake_handled;
+  if (wakeups) *wakeups = awake_wakeups;
+}
+
+/*
+   Coalesced awake callbacks are kept in a hash table by key while they
+   are pending. The first awake_coalesce() for a key adds an entry and
+   queues run_coalesced() for it, later calls only replace the callback
+   and data of the entry. The table is guarded by a spin lock, which is
+   held for a few instructions only.
+*/
+
+struct Fl_Awake_Entry {
+  Fl_Awake_Entry *next;
+  const void *key;
+  Fl_Awake_Handler func;
+  void *data;
+};
+
+#define COALESCE_BUCKETS 64
+
+static Fl_Awake_Entry *coalesce_table[COALESCE_BUCKETS];
+static volatile int coalesce_lock;
+static volatile int coalesce_replaced;	// number of replaced callbacks
+
+static void lock_coalesce() {
+  while (atomic_exchange(&coalesce_lock, 1)) {
+#ifdef WIN32
+    SwitchToThread();
+#elif defined(HAVE_PTHREAD)
+    sched_yield();
+#else
+    ;
+#endif
+  }
+}
+
+static void unlock_coalesce() {
+  atomic_exchange(&coalesce_lock, 0);
+}
+
+static inline unsigned coalesce_bucket(const void *key) {
+  return (unsigned)(((fl_intptr_t)key >> 4) * 2654435761u) % COALESCE_BUCKETS;
+}
+
+// Removes the entry from the table and runs its callback:
+static void run_coalesced(void *v) {
+  Fl_Awake_Entry *e = (Fl_Awake_Entry *)v;
+  lock_coalesce();
+  Fl_Awake_Entry **p = coalesce_table + coalesce_bucket(e->key);
+  while (*p != e) p = &(*p)->next;
+  *p = e->next;
+  Fl_Awake_Handler func = e->func;
+  void *data = e->data;
+  unlock_coalesce();
+  free(e);
+  (*func)(data);
+}
+
+/**
+ Like Fl::awake(Fl_Awake_Handler, void*), but replaces a pending callback
+ with the same key.
+
+ If a callback that was registered with the same \p key was not called yet,
+ \p func and \p data replace its function and data, and it keeps its place
+ in the queue of awake callbacks. Otherwise the callback is registered like
+ Fl::awake(func, data) does.
+
+ Use this for updates where only the latest value matters, e.g. with the
+ widget that shows the progress as key. The main thread then runs at
+ most one callback per key each time it is woken up, no matter how often
+ a worker thread posts updates.
+
+ \param[in] key identifies the callback, e.g. the address of a widget
+ \param[in] func the function to call in the main thread
+ \param[in] data the argument of \p func
+ \returns 0 if the callback was registered or replaced, -1 if not
+ \see Fl::awake_stats(), Fl::awake_coalesced()
+*/
+int Fl::awake_coalesce(const void *key, Fl_Awake_Handler func, void *data) {
+  unsigned b = coalesce_bucket(key);
+  lock_coalesce();
+  Fl_Awake_Entry *e;
+  for (e = coalesce_table[b]; e; e = e->next) {
+    if (e->key == key) {
+      e->func = func;
+      e->data = data;
+      coalesce_replaced++;
+      unlock_coalesce();
+      return 0;
+    }
+  }
+  e = (Fl_Awake_Entry *)malloc(sizeof(Fl_Awake_Entry));
+  if (!e) {
+    unlock_coalesce();
+    return -1;
+  }
+  e->key  = key;
+  e->func = func;
+  e->data = data;
+  e->next = coalesce_table[b];
+  coalesce_table[b] = e;
+  unlock_coalesce();
+  if (Fl::awake(run_coalesced, e) == 0) return 0;
+  // the entry was not queued, so it was not freed:
+  lock_coalesce();
+  Fl_Awake_Entry **p = coalesce_table + b;
+  while (*p != e) p = &(*p)->next;
+  *p = e->next;
+  unlock_coalesce();
+  free(e);
+  return -1;
+}
+
+/**
+ Returns the number of callbacks that were replaced by
+ Fl::awake_coalesce() instead of being queued.
+*/
+int Fl::awake_coalesced() {
+  return coalesce_replaced;
+}
+
 ////////////////////////////////////////////////////////////////
 // Windows threading...
 /** \fn int Fl::lock()
@@ -202,19 +466,6 @@ static DWORD main_thread;
 
 // Microsoft's version of a MUTEX...
 CRITICAL_SECTION cs;
-CRITICAL_SECTION *cs_ring;
-
-void unlock_ring() {
-  LeaveCriticalSection(cs_ring);
-}
-
-void lock_ring() {
-  if (!cs_ring) {
-    cs_ring = (CRITICAL_SECTION*)malloc(sizeof(CRITICAL_SECTION));
-    InitializeCriticalSection(cs_ring);
-  }
-  EnterCriticalSection(cs_ring);
-}
 
 //
 // 'unlock_function()' - Release the lock.
@@ -241,6 +492,9 @@ int Fl::lock() {
     fl_lock_function   = lock_function;
     fl_unlock_function = unlock_function;
     main_thread        = GetCurrentThreadId();
+    // awake(cb, data) could not wake up the main thread before, so the
+    // next call must post a message again:
+    atomic_exchange(&awake_pending, 0);
   }
   return 0;
 }
@@ -321,11 +575,7 @@ static void thread_awake_cb(int fd, void*) {
   if (read(fd, &thread_message_, sizeof(void*))==0) { 
     /* This should never happen */
   }
-  Fl_Awake_Handler func;
-  void *data;
-  while (Fl::get_awake_handler_(func, data)==0) {
-    (*func)(data);
-  }
+  fl_run_awake_handlers();
 }
 
 // These pointers are in Fl_x.cxx:
@@ -350,6 +600,10 @@ int Fl::lock() {
     // Fl::wait().
     Fl::add_fd(thread_filedes[0], FL_READ, thread_awake_cb);
 
+    // awake(cb, data) could not wake up the main thread before, so the
+    // next call must write to the pipe again:
+    atomic_exchange(&awake_pending, 0);
+
     // Set lock/unlock functions for this system, using a system-supplied
     // recursive mutex if supported...
 #  ifdef PTHREAD_MUTEX_RECURSIVE
@@ -374,28 +628,32 @@ void Fl::unlock() {
   fl_unlock_function();
 }
 
-// Mutex code for the awake ring buffer
+#  ifdef AWAKE_USE_MUTEX
+// Mutex code for the awake queue
 static pthread_mutex_t *ring_mutex;
 
-void unlock_ring() {
+static void unlock_ring() {
   pthread_mutex_unlock(ring_mutex);
 }
 
-void lock_ring() {
+static void lock_ring() {
   if (!ring_mutex) {
     ring_mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
     pthread_mutex_init(ring_mutex, NULL);
   }
   pthread_mutex_lock(ring_mutex);
 }
+#  endif // AWAKE_USE_MUTEX
 
 #else
 
-void unlock_ring() {
+#  ifdef AWAKE_USE_MUTEX
+static void unlock_ring() {
 }
 
-void lock_ring() {
+static void lock_ring() {
 }
+#  endif // AWAKE_USE_MUTEX
 
 void Fl::awake(void*) {
 }
@@ -346,14 +346,12 @@ extern int fl_send_system_handlers(void *e);
 
 MSG fl_msg;
 
+extern void fl_run_awake_handlers(); // in Fl_lock.cxx
+
 // A local helper function to flush any pending callback requests
-// from the awake ring-buffer
+// from the awake queue
 static void process_awake_handler_requests(void) {
-  Fl_Awake_Handler func;
-  void *data;
-  while (Fl::get_awake_handler_(func, data) == 0) {
-    func(data);
-  }
+  fl_run_awake_handlers();
 }
 
 // This is never called with time_to_wait < 0.0.
@@ -438,7 +436,8 @@ int fl_wait(double time_to_wait) {
 
   // The following conditional test:
   //    (Fl::awake_ring_head_ != Fl::awake_ring_tail_)
-  // is a workaround / fix for STR #3143. This works, but a better solution
+  // is a workaround / fix for STR #3143. The two indices count the
+  // callbacks added to and removed from the awake queue. This works, but a better solution
   // would be to understand why the PostThreadMessage() messages are not
   // seen by the main window if it is being dragged/ resized at the time.
   // If a worker thread posts an awake callback to the ring buffer
@@ -1258,60 +1258,257 @@ static int wasXExceptionRaised() {
 
 }
 
-static bool getNextEvent(XEvent *event_return)
-{
-  time_t t = time(NULL);
-  while(!XPending(fl_display))
-  {
-    if(time(NULL) - t > 10.0)
-    {
-      //fprintf(stderr,"Error: The XNextEvent never came...\n");
-      return false; 
+////////////////////////////////////////////////////////////////
+// Incremental (INCR) selection transfers, see ICCCM section 2.7.2.
+//
+// Selections that don't fit in one X request are sent in chunks: the
+// owner sets the property to type INCR, and writes the next chunk each
+// time the requestor has deleted the property, ending with an empty
+// chunk. Both sides are driven by PropertyNotify events, so the
+// programs keep handling their other events during a large transfer.
+
+static unsigned char* sn_buffer = 0;	// data of the last paste
+
+struct Fl_Incr_Send {
+  Window requestor;
+  Atom property, type;
+  char *data;
+  long length, offset;
+  time_t last;			// time of the last step
+  Fl_Incr_Send *next;
+};
+
+static Fl_Incr_Send *incr_sends = 0;
+
+static struct {
+  Window window;		// 0 if no transfer is being received
+  Atom property;
+  long length;
+  time_t last;
+} incr_receive;
+
+#define INCR_TIMEOUT 30		// seconds without progress before giving up
+
+static long incr_chunk_size() {
+  return XMaxRequestSize(fl_display) * 4 - 100;
+}
+
+static void incr_timeout(void*);
+
+static void start_incr_timeout() {
+  if (!Fl::has_timeout(incr_timeout)) Fl::add_timeout(5.0, incr_timeout);
+}
+
+// Returns 1 if a transfer to the window is running:
+static int incr_sending_to(Window requestor) {
+  for (Fl_Incr_Send *s = incr_sends; s; s = s->next)
+    if (s->requestor == requestor) return 1;
+  return 0;
+}
+
+static void remove_incr_send(Fl_Incr_Send *s) {
+  for (Fl_Incr_Send **p = &incr_sends; *p; p = &(*p)->next) {
+    if (*p == s) { *p = s->next; break; }
+  }
+  // other transfers to the same window still need its events:
+  if (s->requestor && !fl_find(s->requestor) && !incr_sending_to(s->requestor))
+    XSelectInput(fl_display, s->requestor, NoEventMask);
+  free(s->data);
+  delete s;
+}
+
+// Sets a property of the requestor of a selection to the data, or
+// starts an INCR transfer if the data is too large for one request.
+// Returns 0 if the data can't be sent, the request must then be refused.
+static int send_selection(Window requestor, Atom property, Atom type,
+                          const char *data, long length) {
+  if (length <= incr_chunk_size()) {
+    XChangeProperty(fl_display, requestor, property, type, 8, 0,
+                    (unsigned char *)data, length);
+    return 1;
+  }
+  // the data is copied, as the selection may change during the transfer
+  char *copy = (char *)malloc(length);
+  if (!copy) return 0;
+  memcpy(copy, data, length);
+  for (Fl_Incr_Send *s = incr_sends; s; s = s->next) {
+    if (s->requestor == requestor && s->property == property) {
+      remove_incr_send(s);
+      break;
     }
   }
-  XNextEvent(fl_display, event_return);
-  return true;
+  Fl_Incr_Send *s = new Fl_Incr_Send;
+  s->requestor = requestor;
+  s->property = property;
+  s->type = type;
+  s->data = copy;
+  s->length = length;
+  s->offset = 0;
+  s->last = time(NULL);
+  if (!fl_find(requestor) && !incr_sending_to(requestor))
+    XSelectInput(fl_display, requestor, PropertyChangeMask | StructureNotifyMask);
+  s->next = incr_sends;
+  incr_sends = s;
+  long size = length;
+  XChangeProperty(fl_display, requestor, property, fl_INCR, 32, 0,
+                  (unsigned char *)&size, 1);
+  start_incr_timeout();
+  return 1;
 }
 
-static long getIncrData(uchar* &data, const XSelectionEvent& selevent, long lower_bound)
-{
-//fprintf(stderr,"Incremental transfer starting due to INCR property\n");
-  size_t total = 0;
-  XEvent event;
-  XDeleteProperty(fl_display, selevent.requestor, selevent.property);  
-  data = (uchar*)realloc(data, lower_bound);
-  for (;;)
-  {
-    if (!getNextEvent(&event)) break;
-    if (event.type == PropertyNotify)
-    {
-      if (event.xproperty.state != PropertyNewValue) continue;
-      Atom actual_type;
-      int actual_format;
-      unsigned long nitems;
-      unsigned long bytes_after;
-      unsigned char* prop = 0;
-      long offset = 0;
-      size_t num_bytes;
-      //size_t slice_size = 0;
-      do
-      {
-	XGetWindowProperty(fl_display, selevent.requestor, selevent.property, offset, 70000, True,
-			   AnyPropertyType, &actual_type, &actual_format, &nitems, &bytes_after, &prop);
-	num_bytes = nitems * (actual_format / 8);
-	offset += num_bytes/4;
-	//slice_size += num_bytes;
-	if (total + num_bytes > (size_t)lower_bound) data = (uchar*)realloc(data, total + num_bytes);
-	memcpy(data + total, prop, num_bytes); total += num_bytes;
-	if (prop) XFree(prop);
-      } while (bytes_after != 0);
-//fprintf(stderr,"INCR data size:%ld\n", slice_size);
-      if (num_bytes == 0) break;
+// Writes the next chunk when the requestor has deleted the last one.
+// Returns 1 if the event belonged to an INCR transfer.
+static int incr_send_next(const XPropertyEvent &e) {
+  if (e.state != PropertyDelete) return 0;
+  Fl_Incr_Send *s;
+  for (s = incr_sends; s; s = s->next) {
+    if (s->requestor == e.window && s->property == e.atom) break;
+  }
+  if (!s) return 0;
+  long n = s->length - s->offset;
+  if (n > incr_chunk_size()) n = incr_chunk_size();
+  XChangeProperty(fl_display, s->requestor, s->property, s->type, 8, 0,
+                  (unsigned char *)s->data + s->offset, n);
+  s->offset += n;
+  s->last = time(NULL);
+  if (!n) remove_incr_send(s);	// the empty chunk ends the transfer
+  return 1;
+}
+
+static void incr_window_destroyed(Window w) {
+  Fl_Incr_Send *s = incr_sends;
+  while (s) {
+    Fl_Incr_Send *next = s->next;
+    if (s->requestor == w) {
+      s->requestor = 0;		// don't touch the destroyed window
+      remove_incr_send(s);
+    }
+    s = next;
+  }
+}
+
+static void start_incr_receive(const XSelectionEvent &e, long lower_bound) {
+  if (sn_buffer) { free(sn_buffer); sn_buffer = 0; }
+  sn_buffer = (unsigned char *)malloc(lower_bound > 0 ? lower_bound + 1 : 1);
+  incr_receive.window = e.requestor;
+  incr_receive.property = e.property;
+  incr_receive.length = 0;
+  incr_receive.last = time(NULL);
+  // deleting the property asks the owner for the first chunk:
+  XDeleteProperty(fl_display, e.requestor, e.property);
+  start_incr_timeout();
+}
+
+static int paste_selection(long bytesread, Window requestor, Atom property);
+
+// Appends the next chunk when the owner has written it, and pastes the
+// data after the empty chunk. Returns 1 if the event belonged to the
+// INCR transfer.
+static int incr_receive_next(const XPropertyEvent &e) {
+  if (e.state != PropertyNewValue || !incr_receive.window ||
+      e.window != incr_receive.window || e.atom != incr_receive.property) return 0;
+  long n = 0;
+  for (long offset = 0;;) {
+    Atom actual; int format; unsigned long count, remaining;
+    unsigned char* portion = NULL;
+    if (XGetWindowProperty(fl_display, e.window, e.atom, offset, 65536, True,
+                           AnyPropertyType, &actual, &format, &count,
+                           &remaining, &portion) != Success) {
+      incr_receive.window = 0; // give up
+      return 1;
+    }
+    if (actual == None) return 1; // already deleted, not a chunk
+    long bytes = count * (format / 8);
+    if (bytes) {
+      unsigned char *b = (unsigned char *)realloc(sn_buffer, incr_receive.length + bytes + remaining + 1);
+      if (!b) { XFree(portion); incr_receive.window = 0; return 1; }
+      sn_buffer = b;
+      memcpy(sn_buffer + incr_receive.length, portion, bytes);
+      incr_receive.length += bytes;
+      n += bytes;
+      offset += bytes / 4;
     }
-    else break;
+    if (portion) XFree(portion);
+    if (!remaining) break;
+  }
+  incr_receive.last = time(NULL);
+  if (n) return 1;
+  // the empty chunk, the transfer is complete:
+  Window requestor = incr_receive.window;
+  incr_receive.window = 0;
+  sn_buffer[incr_receive.length] = 0;
+  paste_selection(incr_receive.length, requestor, e.atom);
+  return 1;
+}
+
+// Gives up transfers that made no progress for a while...
+static void incr_timeout(void*) {
+  time_t now = time(NULL);
+  Fl_Incr_Send *s = incr_sends;
+  while (s) {
+    Fl_Incr_Send *next = s->next;
+    if (now - s->last > INCR_TIMEOUT) remove_incr_send(s);
+    s = next;
+  }
+  if (incr_receive.window && now - incr_receive.last > INCR_TIMEOUT)
+    incr_receive.window = 0;
+  if (incr_sends || incr_receive.window) Fl::repeat_timeout(5.0, incr_timeout);
+}
+
+// Sends the received selection data in sn_buffer to the widget that
+// asked for it with Fl::paste()...
+static int paste_selection(long bytesread, Window requestor, Atom property) {
+  if (sn_buffer && Fl::e_clipboard_type == Fl::clipboard_plain_text) {
+    sn_buffer[bytesread] = 0;
+    convert_crlf(sn_buffer, bytesread);
+  }
+  if (!fl_selection_requestor) return 0;
+  if (Fl::e_clipboard_type == Fl::clipboard_image) {
+    if (bytesread == 0) return 0;
+    static char tmp_fname[21];
+    static Fl_Shared_Image *shared = 0;
+    strcpy(tmp_fname, "/tmp/clipboardXXXXXX");
+    int fd = mkstemp(tmp_fname);
+    if (fd == -1) return 0;
+    uchar *p = sn_buffer; ssize_t towrite = bytesread, written;
+    while (towrite) {
+      written = write(fd, p, towrite);
+      p += written; towrite -= written;
+    }
+    close(fd);
+    free(sn_buffer); sn_buffer = 0;
+    shared = Fl_Shared_Image::get(tmp_fname);
+    unlink(tmp_fname);
+    if (!shared) return 0;
+    uchar *rgb = new uchar[shared->w() * shared->h() * shared->d()];
+    memcpy(rgb, shared->data()[0], shared->w() * shared->h() * shared->d());
+    Fl_RGB_Image *image = new Fl_RGB_Image(rgb, shared->w(), shared->h(), shared->d());
+    shared->release();
+    image->alloc_array = 1;
+    Fl::e_clipboard_data = (void*)image;
+  }
+  else if (Fl::e_clipboard_type == Fl::clipboard_plain_text) {
+    Fl::e_text = sn_buffer ? (char*)sn_buffer : (char *)"";
+    Fl::e_length = bytesread;
+    }
+  int old_event = Fl::e_number;
+  int retval = fl_selection_requestor->handle(Fl::e_number = FL_PASTE);
+  if (!retval && Fl::e_clipboard_type == Fl::clipboard_image) {
+    delete (Fl_RGB_Image*)Fl::e_clipboard_data;
+    Fl::e_clipboard_data = NULL;
+  }
+  Fl::e_number = old_event;
+  // Detect if this paste is due to Xdnd by the property name (I use
+  // XA_SECONDARY for that) and send an XdndFinished message. It is not
+  // clear if this has to be delayed until now or if it can be done
+  // immediately after calling XConvertSelection.
+  if (property == XA_SECONDARY &&
+      fl_dnd_source_window) {
+    fl_sendClientMessage(fl_dnd_source_window, fl_XdndFinished,
+                         requestor);
+    fl_dnd_source_window = 0; // don't send a second time
   }
-  XDeleteProperty(fl_display, selevent.requestor, selevent.property);
-  return (long)total;
+  return 1;
 }
 
 /* Internal function to reduce "deprecated" warnings for XKeycodeToKeysym().
@@ -1362,6 +1559,13 @@ int fl_handle(const XEvent& thisevent)
   if (xevent.type == PropertyNotify && xevent.xproperty.atom == fl_NET_WORKAREA) {
     fl_init_workarea();
   }
+
+  if (xevent.type == PropertyNotify &&
+      (incr_send_next(xevent.xproperty) || incr_receive_next(xevent.xproperty)))
+    return 1;
+
+  if (xevent.type == DestroyNotify && incr_sends)
+    incr_window_destroyed(xevent.xdestroywindow.window);
   
   switch (xevent.type) {
 
@@ -1374,9 +1578,12 @@ int fl_handle(const XEvent& thisevent)
     return 0;
 
   case SelectionNotify: {
-    static unsigned char* sn_buffer = 0;
     //static const char *buffer_format = 0;
-    if (sn_buffer) {XFree(sn_buffer); sn_buffer = 0;}
+    if (fl_xevent->xselection.property != PRIMARY_TIMESTAMP &&
+        fl_xevent->xselection.property != CLIPBOARD_TIMESTAMP) {
+      incr_receive.window = 0; // a new paste cancels an incremental one
+      if (sn_buffer) {free(sn_buffer); sn_buffer = 0;}
+    }
     long bytesread = 0;
     if (fl_xevent->xselection.property) for (;;) {
       // The Xdnd code pastes 64K chunks together, possibly to avoid
@@ -1457,9 +1664,10 @@ fprintf(stderr,"\n");*/
 	return true;
       }
 	if (actual == fl_INCR) {
-	  bytesread = getIncrData(sn_buffer, xevent.xselection, *(long*)portion);
+	  // the data follows in chunks, see incr_receive_next()
+	  start_incr_receive(xevent.xselection, portion && count ? *(long*)portion : 0);
 	  XFree(portion);
-	  break;
+	  return true;
 	}
 	// Make sure we got something sane...
       if ((portion == NULL) || (format != 8) || (count == 0)) {
@@ -1474,57 +1682,8 @@ fprintf(stderr,"\n");*/
       sn_buffer[bytesread] = '\0';
       if (!remaining) break;
     }
-    if (sn_buffer && Fl::e_clipboard_type == Fl::clipboard_plain_text) {
-      sn_buffer[bytesread] = 0;
-      convert_crlf(sn_buffer, bytesread);
-    }
-    if (!fl_selection_requestor) return 0;
-    if (Fl::e_clipboard_type == Fl::clipboard_image) {
-      if (bytesread == 0) return 0;
-      static char tmp_fname[21];
-      static Fl_Shared_Image *shared = 0;
-      strcpy(tmp_fname, "/tmp/clipboardXXXXXX");
-      int fd = mkstemp(tmp_fname);
-      if (fd == -1) return 0;
-      uchar *p = sn_buffer; ssize_t towrite = bytesread, written;
-      while (towrite) {
-	written = write(fd, p, towrite);
-	p += written; towrite -= written;
-	}
-      close(fd);
-      free(sn_buffer); sn_buffer = 0;
-      shared = Fl_Shared_Image::get(tmp_fname);
-      unlink(tmp_fname);
-      if (!shared) return 0;
-      uchar *rgb = new uchar[shared->w() * shared->h() * shared->d()];
-      memcpy(rgb, shared->data()[0], shared->w() * shared->h() * shared->d());
-      Fl_RGB_Image *image = new Fl_RGB_Image(rgb, shared->w(), shared->h(), shared->d());
-      shared->release();
-      image->alloc_array = 1;
-      Fl::e_clipboard_data = (void*)image;
-    }
-    else if (Fl::e_clipboard_type == Fl::clipboard_plain_text) {
-      Fl::e_text = sn_buffer ? (char*)sn_buffer : (char *)"";
-      Fl::e_length = bytesread;
-      }
-    int old_event = Fl::e_number;
-    int retval = fl_selection_requestor->handle(Fl::e_number = FL_PASTE);
-    if (!retval && Fl::e_clipboard_type == Fl::clipboard_image) {
-      delete (Fl_RGB_Image*)Fl::e_clipboard_data;
-      Fl::e_clipboard_data = NULL;
-    }
-    Fl::e_number = old_event;
-    // Detect if this paste is due to Xdnd by the property name (I use
-    // XA_SECONDARY for that) and send an XdndFinished message. It is not
-    // clear if this has to be delayed until now or if it can be done
-    // immediately after calling XConvertSelection.
-    if (fl_xevent->xselection.property == XA_SECONDARY &&
-        fl_dnd_source_window) {
-      fl_sendClientMessage(fl_dnd_source_window, fl_XdndFinished,
-                           fl_xevent->xselection.requestor);
-      fl_dnd_source_window = 0; // don't send a second time
-    }
-    return 1;}
+    return paste_selection(bytesread, fl_xevent->xselection.requestor,
+                           fl_xevent->xselection.property);}
 
   case SelectionClear: {
     int clipboard = fl_xevent->xselectionclear.selection == CLIPBOARD;
@@ -1559,10 +1718,10 @@ fprintf(stderr,"\n");*/
 	    // behave that insist on asking for XA_TEXT instead of UTF8_STRING
 	    // Does not change XA_STRING as that breaks xclipboard.
 	    if (e.target != XA_STRING) e.target = fl_XaUtf8String;
-	    XChangeProperty(fl_display, e.requestor, e.property,
-		            e.target, 8, 0,
-		            (unsigned char *)fl_selection_buffer[clipboard],
-		            fl_selection_length[clipboard]);
+	    if (!send_selection(e.requestor, e.property, e.target,
+	                        fl_selection_buffer[clipboard],
+	                        fl_selection_length[clipboard]))
+	      e.property = 0;
 	  }
 	} else {
 	  //    char* x = XGetAtomName(fl_display,e.target);
@@ -1578,10 +1737,10 @@ fprintf(stderr,"\n");*/
 	                XA_ATOM, atom_bits, 0, (unsigned char*)a, 1);
       } else {
 	if (e.target == fl_XaImageBmp && fl_selection_length[clipboard]) {
-	    XChangeProperty(fl_display, e.requestor, e.property,
-		            e.target, 8, 0,
-		            (unsigned char *)fl_selection_buffer[clipboard],
-		            fl_selection_length[clipboard]);
+	    if (!send_selection(e.requestor, e.property, e.target,
+	                        fl_selection_buffer[clipboard],
+	                        fl_selection_length[clipboard]))
+	      e.property = 0;
 	} else {
 	  e.property = 0;
 	}
@@ -38,10 +38,15 @@
 #endif
 #include <config.h>
 
+#ifdef USE_X11
+void fl_sync_gc(); // from fl_rect.cxx
+#endif
+
 void Fl_Graphics_Driver::arc(int x,int y,int w,int h,double a1,double a2) {
   if (w <= 0 || h <= 0) return;
 
 #if defined(USE_X11)
+  fl_sync_gc();
   XDrawArc(fl_display, fl_window, fl_gc, x,y,w-1,h-1, int(a1*64),int((a2-a1)*64));
 #elif defined(WIN32)
   int xa = x+w/2+int(w*cos(a1/180.0*M_PI));
@@ -77,6 +82,7 @@ void Fl_Graphics_Driver::pie(int x,int y,int w,int h,double a1,double a2) {
   if (w <= 0 || h <= 0) return;
 
 #if defined(USE_X11)
+  fl_sync_gc();
   XDrawArc(fl_display, fl_window, fl_gc, x,y,w-1,h-1, int(a1*64),int((a2-a1)*64));
   XFillArc(fl_display, fl_window, fl_gc, x,y,w-1,h-1, int(a1*64),int((a2-a1)*64));
 #elif defined(WIN32)
@@ -23,6 +23,8 @@
 
 // Implementation of fl_color(i), fl_color(r,g,b).
 
+extern void fl_group_cache_changed(); // in Fl_Group.cxx
+
 #ifdef WIN32
 #  include "fl_color_win32.cxx"
 #elif defined(__APPLE__)
@@ -115,6 +117,8 @@ Fl_XColor fl_xmap[1][256];
 #    define fl_overlay 0
 #  endif
 
+void fl_batch_color(ulong pixel); // from fl_rect.cxx
+
 void Fl_Xlib_Graphics_Driver::color(Fl_Color i) {
   if (i & 0xffffff00) {
     unsigned rgb = (unsigned)i;
@@ -122,14 +126,18 @@ void Fl_Xlib_Graphics_Driver::color(Fl_Color i) {
   } else {
     Fl_Graphics_Driver::color(i);
     if(!fl_gc) return; // don't get a default gc if current window is not yet created/valid
-    XSetForeground(fl_display, fl_gc, fl_xpixel(i));
+    ulong pixel = fl_xpixel(i);
+    fl_batch_color(pixel);
+    XSetForeground(fl_display, fl_gc, pixel);
   }
 }
 
 void Fl_Xlib_Graphics_Driver::color(uchar r,uchar g,uchar b) {
   Fl_Graphics_Driver::color( fl_rgb_color(r, g, b) );
   if(!fl_gc) return; // don't get a default gc if current window is not yet created/valid
-  XSetForeground(fl_display, fl_gc, fl_xpixel(r,g,b));
+  ulong pixel = fl_xpixel(r,g,b);
+  fl_batch_color(pixel);
+  XSetForeground(fl_display, fl_gc, pixel);
 }
 
 /** \addtogroup  fl_attributes
@@ -339,6 +347,7 @@ void Fl::free_color(Fl_Color i, int overlay) {
 */
 void Fl::set_color(Fl_Color i, unsigned c) {
   if (fl_cmap[i] != c) {
+    fl_group_cache_changed();
     free_color(i,0);
 #  if HAVE_OVERLAY
     free_color(i,1);
@@ -70,6 +70,7 @@ void Fl_Quartz_Graphics_Driver::color(uchar r, uchar g, uchar b) {
 
 void Fl::set_color(Fl_Color i, unsigned c) {
   if (fl_cmap[i] != c) {
+    fl_group_cache_changed();
     fl_cmap[i] = c;
   }
 }
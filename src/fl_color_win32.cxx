@@ -187,6 +187,7 @@ void Fl::free_color(Fl_Color i, int overlay) {
 
 void Fl::set_color(Fl_Color i, unsigned c) {
   if (fl_cmap[i] != c) {
+    fl_group_cache_changed();
     clear_xmap(fl_xmap[i]);
     fl_cmap[i] = c;
   }
@@ -137,6 +137,162 @@ fl_expand_text(const char* from, char* buf, int maxbuf, double maxw, int& n,
   return expand_text_(from,  buf, maxbuf, maxw,  n, width,  wrap,  draw_symbols);
 }
 
+//
+// Text layout cache...
+//
+// Labels are usually measured and then drawn with the same string, font,
+// and width, and are drawn again on each redraw.  The lines that
+// expand_text_() produces for fl_draw() and fl_measure() are therefore
+// kept in a small cache, keyed by the string contents and everything
+// else that changes the result.  The string is compared, not only its
+// address, since programs often reuse a buffer for changing labels.
+//
+
+#define LAYOUT_SLOTS	64	// number of cached layouts
+#define LAYOUT_MAX	4096	// longer strings are not cached
+
+struct Fl_Layout_Line {
+  int start;			// offset of the expanded text in Fl_Text_Layout::text
+  int n;			// length of the expanded text
+  double width;			// width of the line
+  int underline;		// offset of the underlined character, or -1
+};
+
+struct Fl_Text_Layout {
+  // key:
+  unsigned hash;
+  int len;
+  char *str;
+  Fl_Graphics_Driver *driver;
+  const char *fontname;		// changes when Fl::set_font() is called
+  Fl_Font font;
+  Fl_Fontsize size;
+  int maxw, wrap, draw_symbols, shortcut;
+  // result:
+  int lines;
+  double max_width;
+  Fl_Layout_Line *line;
+  char *text;
+  // cache management:
+  unsigned long used;		// LRU stamp, 0 for unused slots
+  int busy;			// in use by fl_draw(), don't replace
+  int temp;			// not in the cache, free after use
+};
+
+static Fl_Text_Layout layout_cache[LAYOUT_SLOTS];
+static unsigned long layout_clock;
+
+static void free_layout(Fl_Text_Layout *l) {
+  free(l->str);
+  free(l->line);
+  free(l->text);
+  l->str = 0; l->line = 0; l->text = 0;
+  l->used = 0;
+}
+
+static void build_layout(Fl_Text_Layout *l, const char *str, int len) {
+  char *linebuf = NULL;
+  int buflen, lines = 0, nline = 0, ntext = 0, atext = 0;
+  double width;
+  const char *p, *e;
+
+  l->str = (char *)malloc(len + 1);
+  memcpy(l->str, str, len + 1);
+  l->line = 0;
+  l->text = 0;
+  l->max_width = 0;
+
+  for (p = str; p;) {
+    e = expand_text_(p, linebuf, 0, l->maxw, buflen, width, l->wrap, l->draw_symbols);
+    if (lines >= nline) {
+      nline = nline ? 2 * nline : 4;
+      l->line = (Fl_Layout_Line *)realloc(l->line, nline * sizeof(Fl_Layout_Line));
+    }
+    if (ntext + buflen + 1 > atext) {
+      atext = 2 * (ntext + buflen + 1);
+      l->text = (char *)realloc(l->text, atext);
+    }
+    Fl_Layout_Line *line = l->line + lines;
+    line->start = ntext;
+    line->n = buflen;
+    line->width = width;
+    line->underline = (underline_at && underline_at >= linebuf &&
+                       underline_at < linebuf + buflen) ? (int)(underline_at - linebuf) : -1;
+    memcpy(l->text + ntext, linebuf, buflen + 1);	// keep the nul for callthis()
+    ntext += buflen + 1;
+    if (width > l->max_width) l->max_width = width;
+    lines++;
+    if (!*e || (*e == '@' && e[1] != '@' && l->draw_symbols)) break;
+    p = e;
+  }
+  l->lines = lines;
+}
+
+/*
+  Returns the lines of str in the current font, from the cache if possible.
+  The layout is valid until the next call unless it is pinned with busy,
+  and must be given back with release_layout().
+*/
+static Fl_Text_Layout *text_layout(const char *str, double maxw, int wrap, int draw_symbols) {
+  unsigned hash = 2166136261U;
+  int len = 0;
+  for (const char *p = str; *p; p++, len++) hash = (hash ^ (uchar)*p) * 16777619U;
+
+  Fl_Graphics_Driver *driver = fl_graphics_driver;
+  Fl_Font font = fl_font();
+  Fl_Fontsize size = fl_size();
+  const char *fontname = Fl::get_font(font);
+  // the width only matters when wrapping:
+  int imaxw = wrap ? (int)maxw : 0;
+  int shortcut = fl_draw_shortcut;
+  wrap = wrap ? 1 : 0;
+  draw_symbols = draw_symbols ? 1 : 0;
+
+  Fl_Text_Layout *l, *slot = 0;
+  if (len <= LAYOUT_MAX) {
+    for (int i = 0; i < LAYOUT_SLOTS; i++) {
+      l = layout_cache + i;
+      if (l->used && l->hash == hash && l->len == len && l->driver == driver &&
+          l->font == font && l->size == size && l->fontname == fontname &&
+          l->maxw == imaxw && l->wrap == wrap && l->draw_symbols == draw_symbols &&
+          l->shortcut == shortcut && !memcmp(l->str, str, len)) {
+        l->used = ++layout_clock;
+        return l;
+      }
+      if (!l->busy && (!slot || l->used < slot->used)) slot = l;
+    }
+  }
+
+  if (slot) {
+    if (slot->used) free_layout(slot);
+    l = slot;
+  } else {
+    // too long, or all slots are in use by nested fl_draw() calls:
+    l = (Fl_Text_Layout *)calloc(1, sizeof(Fl_Text_Layout));
+    l->temp = 1;
+  }
+  l->hash = hash;
+  l->len = len;
+  l->driver = driver;
+  l->fontname = fontname;
+  l->font = font;
+  l->size = size;
+  l->maxw = imaxw;
+  l->wrap = wrap;
+  l->draw_symbols = draw_symbols;
+  l->shortcut = shortcut;
+  build_layout(l, str, len);
+  l->used = ++layout_clock;
+  return l;
+}
+
+static void release_layout(Fl_Text_Layout *l) {
+  if (l->temp) {
+    free_layout(l);
+    free(l);
+  }
+}
+
 /**
   The same as fl_draw(const char*,int,int,int,int,Fl_Align,Fl_Image*,int) with
   the addition of the \p callthis parameter, which is a pointer to a text drawing
@@ -149,14 +305,12 @@ void fl_draw(
     void (*callthis)(const char*,int,int,int),
     Fl_Image* img, int draw_symbols)
 {
-  char *linebuf = NULL;
   const char* p;
-  const char* e;
-  int buflen;
   char symbol[2][255], *symptr;
   int symwidth[2], symoffset, symtotal, imgtotal;
+  Fl_Text_Layout *layout = 0;
 
-  // count how many lines and put the last one into the buffer:
+  // count how many lines:
   int lines;
   double width;
 
@@ -193,14 +347,10 @@ void fl_draw(
   int strh;
 
   if (str) {
-    for (p = str, lines=0; p;) {
-      e = expand_text_(p, linebuf, 0, w - symtotal - imgtotal, buflen, width,
-                         align&FL_ALIGN_WRAP, draw_symbols);
-      if (strw<width) strw = (int)width;
-      lines++;
-      if (!*e || (*e == '@' && e[1] != '@' && draw_symbols)) break;
-      p = e;
-    }
+    layout = text_layout(str, w - symtotal - imgtotal, align&FL_ALIGN_WRAP, draw_symbols);
+    layout->busy++;	// callthis() may call fl_draw() again
+    lines = layout->lines;
+    strw = (int)layout->max_width;
   } else lines = 0;
 
   if ((symwidth[0] || symwidth[1]) && lines) {
@@ -258,12 +408,12 @@ void fl_draw(
   }
 
   // now draw all the lines:
-  if (str) {
+  if (layout) {
     int desc = fl_descent();
-    for (p=str; ; ypos += height) {
-      if (lines>1) e = expand_text_(p, linebuf, 0, w - symtotal - imgtotal, buflen,
-				width, align&FL_ALIGN_WRAP, draw_symbols);
-      else e = "";
+    for (int i = 0; i < lines; i++, ypos += height) {
+      const Fl_Layout_Line *line = layout->line + i;
+      const char *linebuf = layout->text + line->start;
+      width = line->width;
 
       if (width > symoffset) symoffset = (int)(width + 0.5);
 
@@ -271,14 +421,14 @@ void fl_draw(
       else if (align & FL_ALIGN_RIGHT) xpos = x + w - (int)(width + .5) - symwidth[1] - imgw[1];
       else xpos = x + (w - (int)(width + .5) - symtotal - imgw[0] - imgw[1]) / 2 + symwidth[0] + imgw[0];
 
-      callthis(linebuf,buflen,xpos,ypos-desc);
-
-      if (underline_at && underline_at >= linebuf && underline_at < (linebuf + buflen))
-	callthis("_",1,xpos+int(fl_width(linebuf,(int) (underline_at-linebuf))),ypos-desc);
+      callthis(linebuf,line->n,xpos,ypos-desc);
 
-      if (!*e || (*e == '@' && e[1] != '@')) break;
-      p = e;
+      if (line->underline >= 0)
+	callthis("_",1,xpos+int(fl_width(linebuf,line->underline)),ypos-desc);
     }
+    ypos -= height;
+    layout->busy--;
+    release_layout(layout);
   }
 
   // draw the image if the "text over image" alignment flag is set...
@@ -380,12 +530,8 @@ void fl_draw(
 void fl_measure(const char* str, int& w, int& h, int draw_symbols) {
   if (!str || !*str) {w = 0; h = 0; return;}
   h = fl_height();
-  char *linebuf = NULL;
   const char* p;
-  const char* e;
-  int buflen;
   int lines;
-  double width=0;
   int W = 0;
   int symwidth[2], symtotal;
 
@@ -409,15 +555,10 @@ void fl_measure(const char* str, int& w, int& h, int draw_symbols) {
 
   symtotal = symwidth[0] + symwidth[1];
 
-  for (p = str, lines=0; p;) {
-//    e = expand(p, linebuf, w - symtotal, buflen, width, w != 0, draw_symbols);
-    e = expand_text_(p, linebuf, 0, w - symtotal, buflen, width,
-			w != 0, draw_symbols);
-    if ((int)ceil(width) > W) W = (int)ceil(width);
-    lines++;
-    if (!*e || (*e == '@' && e[1] != '@' && draw_symbols)) break;
-    p = e;
-  }
+  Fl_Text_Layout *layout = text_layout(str, w - symtotal, w != 0, draw_symbols);
+  lines = layout->lines;
+  W = (int)ceil(layout->max_width);
+  release_layout(layout);
 
   if ((symwidth[0] || symwidth[1]) && lines) {
     if (symwidth[0]) symwidth[0] = lines * fl_height();
@@ -323,6 +323,10 @@ static void argb_premul_converter(const uchar *from, uchar *to, int w, int delta
              ((from[2] * from[3]) / 255));
 }
 
+static void argb_premul_gray_converter(const uchar *from, uchar *to, int w, int delta) {
+  INNARDS32((unsigned(from[1]) << 24) + ((from[0] * from[1]) / 255) * 0x10101U);
+}
+
 static void bgrx_converter(const uchar *from, uchar *to, int w, int delta) {
   INNARDS32((from[0]<<8)+(from[1]<<16)+(unsigned(from[2])<<24));
 }
@@ -456,6 +460,8 @@ static void figure_out_visual() {
 
 #  define MAXBUFFER 0x40000 // 256k
 
+void fl_sync_gc(); // from fl_rect.cxx
+
 static void innards(const uchar *buf, int X, int Y, int W, int H,
 		    int delta, int linedelta, int mono,
 		    Fl_Draw_Image_Cb cb, void* userdata,
@@ -469,6 +475,8 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
   dx -= X;
   dy -= Y;
 
+  fl_sync_gc();
+
   if (!bytes_per_pixel) figure_out_visual();
   const unsigned oldbpp = bytes_per_pixel;
   const GC oldgc = fl_gc;
@@ -481,7 +489,7 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
   if (alpha) {
     // This flag states the destination format is ARGB32 (big-endian), pre-multiplied.
     bytes_per_pixel = 4;
-    conv = argb_premul_converter;
+    conv = abs(delta) == 2 ? argb_premul_gray_converter : argb_premul_converter;
     xi.depth = 32;
     xi.bits_per_pixel = 32;
 
@@ -35,6 +35,7 @@
 #include <FL/Fl.H>
 #include <FL/fl_draw.H>
 #include <FL/x.H>
+#include <FL/Fl_Indexed_Image.H>
 #include <stdio.h>
 #include "flstring.h"
 
@@ -117,19 +118,12 @@ static void make_unused_color(uchar &r, uchar &g, uchar &b) {
 }
 #endif
 
-int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg) {
-  int w, h;
-  const uchar*const* data = (const uchar*const*)(cdata+1);
-
-  if (!fl_measure_pixmap(cdata, w, h))
-    return 0;
-
-  if ((chars_per_pixel < 1) || (chars_per_pixel > 2))
-    return 0;
-
-  typedef uchar uchar4[4];
-  uchar4 *colors = new uchar4[1<<(chars_per_pixel*8)];
+typedef uchar uchar4[4];
 
+// Parses the color table of XPM data into colors[], which is indexed by
+// the 1 or 2 characters of a pixel, and advances data to the first row.
+// fl_measure_pixmap() must have been called for the same data.
+static void parse_colors(const uchar*const* &data, uchar4 *colors, Fl_Color bg) {
 #ifdef WIN32
   uchar *transparent_c = (uchar *)0; // such that transparent_c[0,1,2] are the RGB of the transparent color
   color_count = 0;
@@ -185,7 +179,9 @@ int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg) {
 	previous_word = p;
 	while (*p && !isspace(*p)) p++;
       }
-      int parse = fl_parse_color((const char*)p, c[0], c[1], c[2]);
+      // "None" is by far the most common color name, don't ask the server:
+      int parse = strncasecmp((const char*)p, "none", 4) &&
+                  fl_parse_color((const char*)p, c[0], c[1], c[2]);
       c[3] = 255;
       if (parse) {
 #ifdef WIN32
@@ -213,21 +209,40 @@ int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg) {
     make_unused_color(r, g, b);
   }
 #endif
+}
+
+// Parses the color table of XPM data for Fl_Indexed_Image.
+// colors[] must have room for 256 or 65536 entries for 1 or 2 characters
+// per pixel. Returns the number of characters per pixel, or 0 on errors.
+int fl_parse_pixmap_colors(const char*const* cdata, uchar* colors, Fl_Color bg) {
+  int w, h;
+  const uchar*const* data = (const uchar*const*)(cdata+1);
+
+  if (!fl_measure_pixmap(cdata, w, h))
+    return 0;
+
+  parse_colors(data, (uchar4 *)colors, bg);
+  return chars_per_pixel;
+}
+
+int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg) {
+  int w, h;
+  const uchar*const* data = (const uchar*const*)(cdata+1);
+
+  if (!fl_measure_pixmap(cdata, w, h))
+    return 0;
+
+  if ((chars_per_pixel < 1) || (chars_per_pixel > 2))
+    return 0;
+
+  uchar4 *colors = new uchar4[1<<(chars_per_pixel*8)];
+
+  parse_colors(data, colors, bg);
+
+  // The pixel characters are indices into colors[]...
+  for (int Y = 0; Y < h; Y++, out += 4 * w)
+    Fl_Indexed_Image::expand(data[Y], w, chars_per_pixel, (uchar *)colors, out, 4);
 
-  U32 *q = (U32*)out;
-  for (int Y = 0; Y < h; Y++) {
-      const uchar* p = data[Y];
-      if (chars_per_pixel <= 1) {
-      for (int X = 0; X < w; X++)
-        memcpy(q++, colors[*p++], 4);
-      } else {
-      for (int X = 0; X < w; X++) {
-        int ind = (*p++)<<8;
-        ind |= *p++;
-        memcpy(q++, colors[ind], 4);
-	}
-      }
-    }
   delete[] colors;
   return 1;
 }
@@ -50,11 +50,29 @@
 #elif defined(__APPLE__)
 #  include "fl_font_mac.cxx"
 #elif USE_XFT
+void fl_sync_gc(); // from fl_rect.cxx
 #  include "fl_font_xft.cxx"
 #else
+void fl_sync_gc(); // from fl_rect.cxx
 #  include "fl_font_x.cxx"
 #endif // WIN32
 
+#if defined(WIN32) || defined(__APPLE__) || !USE_XFT
+// only Xft closes unused fonts:
+void Fl::font_cache_limit(int) {
+}
+
+int Fl::font_cache_limit() {
+  return 0;
+}
+
+void Fl::font_cache_stats(int *open, unsigned long *hits, unsigned long *misses) {
+  if (open) *open = 0;
+  if (hits) *hits = 0;
+  if (misses) *misses = 0;
+}
+#endif
+
 #if ! (defined(WIN32) || defined(__APPLE__))
 XFontStruct *fl_X_core_font()
 {
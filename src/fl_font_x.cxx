@@ -309,6 +309,7 @@ void Fl_Xlib_Graphics_Driver::text_extents(const char *c, int n, int &dx, int &d
 }
 
 void Fl_Xlib_Graphics_Driver::draw(const char* c, int n, int x, int y) {
+  fl_sync_gc();
   if (font_gc != fl_gc) {
     if (!font_descriptor()) this->font(FL_HELVETICA, FL_NORMAL_SIZE);
     font_gc = fl_gc;
@@ -323,6 +324,7 @@ void Fl_Xlib_Graphics_Driver::draw(int angle, const char *str, int n, int x, int
 }
 
 void Fl_Xlib_Graphics_Driver::rtl_draw(const char* c, int n, int x, int y) {
+  fl_sync_gc();
   if (font_gc != fl_gc) {
     if (!font_descriptor()) this->font(FL_HELVETICA, FL_NORMAL_SIZE);
     font_gc = fl_gc;
@@ -106,27 +106,117 @@ void *fl_xftfont = 0;
 //static const char* fl_encoding_ = "iso8859-1";
 static const char* fl_encoding_ = "iso10646-1";
 
+static XftFont* fontopen(const char* name, Fl_Fontsize size, bool core, int angle);
+static void clear_glyph_runs();
+
+/*
+  The font descriptors are kept in a hash table by font, size, and angle.
+  The descriptors with an open XftFont are also kept in a list with the
+  most recently used first, and when there are more than font_limit open
+  fonts, the least recently used fonts are closed. The descriptors stay
+  in the table, since drivers and gl_draw() may still point at them, and
+  their font is opened again when they are used.
+*/
+
+#define FONT_HASH_SIZE 251
+
+static Fl_Font_Descriptor *font_hash[FONT_HASH_SIZE];
+static Fl_Font_Descriptor *lru_first, *lru_last;
+static int font_limit = 64;	// maximum number of open fonts
+static int fonts_open;
+static unsigned long font_hits, font_misses;
+
+static unsigned font_hash_index(Fl_Font fnum, Fl_Fontsize size, int angle) {
+  return ((unsigned)fnum * 31u + (unsigned)size * 7u + (unsigned)angle) % FONT_HASH_SIZE;
+}
+
+static void lru_remove(Fl_Font_Descriptor *f) {
+  if (f->lru_prev) f->lru_prev->lru_next = f->lru_next;
+  else if (lru_first == f) lru_first = f->lru_next;
+  else return;	// not in the list
+  if (f->lru_next) f->lru_next->lru_prev = f->lru_prev;
+  else lru_last = f->lru_prev;
+  f->lru_prev = f->lru_next = 0;
+}
+
+static void lru_insert(Fl_Font_Descriptor *f) {
+  f->lru_prev = 0;
+  f->lru_next = lru_first;
+  if (lru_first) lru_first->lru_prev = f;
+  else lru_last = f;
+  lru_first = f;
+}
+
+// Closes the least recently used fonts that are not in use, except keep:
+static void trim_font_cache(Fl_Font_Descriptor *keep = 0) {
+  Fl_Font_Descriptor *f = lru_last;
+  Fl_Font_Descriptor *display = Fl_Display_Device::display_device()->driver()->font_descriptor();
+  while (fonts_open > font_limit && f) {
+    Fl_Font_Descriptor *prev = f->lru_prev;
+    if (f != keep && f != fl_graphics_driver->font_descriptor() && f != display) {
+      lru_remove(f);
+      clear_glyph_runs();
+      XftFontClose(fl_display, f->font);
+      f->font = 0;
+      fonts_open--;
+    }
+    f = prev;
+  }
+}
+
+// Returns the XftFont of a descriptor. Inactive drivers, like those of
+// Fl_Image_Surface and Fl_Copy_Surface, keep their descriptor, so its font
+// may have been closed by trim_font_cache() and is then opened again.
+static XftFont *xft_font(Fl_Font_Descriptor *f) {
+  if (!f->font) {
+    f->font = fontopen(fl_fonts[f->fnum].name, f->size, false, f->angle);
+    font_misses++;
+    if (!f->font) return 0;
+    fonts_open++;
+    lru_insert(f);
+    if (fonts_open > font_limit) trim_font_cache(f);
+    if (f == fl_graphics_driver->font_descriptor()) fl_xftfont = (void*)f->font;
+  }
+  return f->font;
+}
+
 static void fl_xft_font(Fl_Xlib_Graphics_Driver *driver, Fl_Font fnum, Fl_Fontsize size, int angle) {
   if (fnum==-1) { // special case to stop font caching
     driver->Fl_Graphics_Driver::font(0, 0);
     return;
   }
   Fl_Font_Descriptor* f = driver->font_descriptor();
-  if (fnum == driver->Fl_Graphics_Driver::font() && size == driver->size() && f && f->angle == angle)
+  if (fnum == driver->Fl_Graphics_Driver::font() && size == driver->size() && f && f->angle == angle && f->font)
     return;
   driver->Fl_Graphics_Driver::font(fnum, size);
   Fl_Fontdesc *font = fl_fonts + fnum;
   // search the fontsizes we have generated already
-  for (f = font->first; f; f = f->next) {
-    if (f->size == size && f->angle == angle)// && !strcasecmp(f->encoding, fl_encoding_))
+  unsigned h = font_hash_index(fnum, size, angle);
+  for (f = font_hash[h]; f; f = f->hash_next) {
+    if (f->fnum == fnum && f->size == size && f->angle == angle)// && !strcasecmp(f->encoding, fl_encoding_))
       break;
   }
   if (!f) {
     f = new Fl_Font_Descriptor(font->name, size, angle);
+    f->fnum = fnum;
     f->next = font->first;
     font->first = f;
+    f->hash_next = font_hash[h];
+    font_hash[h] = f;
+    font_misses++;
+    if (f->font) {
+      fonts_open++;
+      lru_insert(f);
+    }
+  } else if (!f->font) {	// the font was closed by trim_font_cache()
+    xft_font(f);
+  } else {
+    lru_remove(f);
+    lru_insert(f);
+    font_hits++;
   }
   driver->font_descriptor(f);
+  if (fonts_open > font_limit) trim_font_cache(f);
 #if XFT_MAJOR < 2
   fl_xfont    = f->font->u.core.font;
 #else
@@ -135,6 +225,34 @@ static void fl_xft_font(Fl_Xlib_Graphics_Driver *driver, Fl_Font fnum, Fl_Fontsi
   fl_xftfont = (void*)f->font;
 }
 
+/**
+  Sets the maximum number of fonts that are kept open.
+  When more fonts are used, the least recently used ones are closed and
+  opened again when they are needed. The default is 64 fonts. This is
+  only used with Xft.
+*/
+void Fl::font_cache_limit(int n) {
+  font_limit = n > 1 ? n : 1;
+  if (fonts_open > font_limit) trim_font_cache();
+}
+
+/** Returns the maximum number of fonts that are kept open. */
+int Fl::font_cache_limit() {
+  return font_limit;
+}
+
+/**
+  Returns statistics of the font cache. All pointers can be NULL.
+  \param[out] open number of open fonts
+  \param[out] hits number of font changes that found an open font
+  \param[out] misses number of font changes that opened a font
+*/
+void Fl::font_cache_stats(int *open, unsigned long *hits, unsigned long *misses) {
+  if (open) *open = fonts_open;
+  if (hits) *hits = font_hits;
+  if (misses) *misses = font_misses;
+}
+
 void Fl_Xlib_Graphics_Driver::font(Fl_Font fnum, Fl_Fontsize size) {
   fl_xft_font(this,fnum,size,0);
 }
@@ -330,6 +448,8 @@ Fl_Font_Descriptor::Fl_Font_Descriptor(const char* name, Fl_Fontsize fsize, int
 //  encoding = fl_encoding_;
   size = fsize;
   angle = fangle;
+  fnum = -1;
+  hash_next = lru_prev = lru_next = 0;
 #if HAVE_GL
   listbase = 0;
 #endif // HAVE_GL
@@ -338,7 +458,17 @@ Fl_Font_Descriptor::Fl_Font_Descriptor(const char* name, Fl_Fontsize fsize, int
 
 Fl_Font_Descriptor::~Fl_Font_Descriptor() {
   if (this == fl_graphics_driver->font_descriptor()) fl_graphics_driver->font_descriptor(NULL);
-//  XftFontClose(fl_display, font);
+  if (fnum >= 0) {
+    Fl_Font_Descriptor **p = font_hash + font_hash_index(fnum, size, angle);
+    while (*p && *p != this) p = &(*p)->hash_next;
+    if (*p) *p = hash_next;
+  }
+  clear_glyph_runs();
+  if (font) {
+    lru_remove(this);
+    fonts_open--;
+    if (fl_display) XftFontClose(fl_display, font);
+  }
 }
 
 /* decodes the input UTF-8 string into a series of wchar_t characters.
@@ -364,24 +494,137 @@ static const wchar_t *utf8reformat(const char *str, int& n)
   return buffer;
 }
 
+/*
+  Labels and other short strings are drawn and measured again and again,
+  so their glyph indices are kept in a cache by font descriptor and
+  string, with the least recently used run evicted first. Their extents
+  are computed when they are needed. The cache is cleared when a font
+  is closed, so a descriptor or font at a reused address can't match.
+*/
+
+#define GLYPH_RUN_BYTES	256	// longer strings are not cached
+#define GLYPH_RUNS	512	// maximum number of cached runs
+#define GLYPH_RUN_HASH	1024
+
+struct Fl_Glyph_Run {
+  Fl_Glyph_Run *hash_next, *prev, *next;
+  Fl_Font_Descriptor *desc;
+  unsigned hash;
+  int len;		// bytes of the UTF-8 string
+  int n;		// number of glyphs
+  int have_extents;
+  XGlyphInfo extents;
+  FT_UInt *glyphs;	// n glyph indices, followed by the string
+  char *str;
+};
+
+static Fl_Glyph_Run *run_hash[GLYPH_RUN_HASH];
+static Fl_Glyph_Run *first_run, *last_run;	// most recently used first
+static int glyph_runs;
+
+static void unlink_run(Fl_Glyph_Run *r) {
+  if (r->prev) r->prev->next = r->next; else first_run = r->next;
+  if (r->next) r->next->prev = r->prev; else last_run = r->prev;
+}
+
+static void clear_glyph_runs() {
+  while (first_run) {
+    Fl_Glyph_Run *r = first_run;
+    first_run = r->next;
+    free(r);
+  }
+  last_run = 0;
+  glyph_runs = 0;
+  memset(run_hash, 0, sizeof(run_hash));
+}
+
+// Returns the glyphs of a string in a font, NULL if the string is not cached:
+static Fl_Glyph_Run *glyph_run(Fl_Font_Descriptor *desc, const char *str, int n) {
+  if (n <= 0 || n > GLYPH_RUN_BYTES || !desc || !desc->font) return 0;
+  unsigned h = 2166136261u ^ (unsigned)((fl_intptr_t)desc >> 4);
+  int i;
+  for (i = 0; i < n; i++) h = (h ^ (uchar)str[i]) * 16777619u;
+  Fl_Glyph_Run **bucket = run_hash + h % GLYPH_RUN_HASH, *r;
+  for (r = *bucket; r; r = r->hash_next) {
+    if (r->hash == h && r->desc == desc && r->len == n && !memcmp(r->str, str, n)) {
+      if (r != first_run) {	// move it to the front
+        unlink_run(r);
+        r->prev = 0;
+        r->next = first_run;
+        first_run->prev = r;
+        first_run = r;
+      }
+      return r;
+    }
+  }
+
+  if (glyph_runs >= GLYPH_RUNS) {	// remove the least recently used run
+    Fl_Glyph_Run *old = last_run, **p = run_hash + old->hash % GLYPH_RUN_HASH;
+    while (*p != old) p = &(*p)->hash_next;
+    *p = old->hash_next;
+    unlink_run(old);
+    free(old);
+    glyph_runs--;
+  }
+
+  // a string of n bytes has at most n characters:
+  r = (Fl_Glyph_Run *)malloc(sizeof(Fl_Glyph_Run) + n * sizeof(FT_UInt) + n);
+  if (!r) return 0;
+  r->glyphs = (FT_UInt *)(r + 1);
+  r->str = (char *)(r->glyphs + n);
+  memcpy(r->str, str, n);
+  r->desc = desc;
+  r->hash = h;
+  r->len = n;
+  r->have_extents = 0;
+  const char *p = str, *e = str + n;
+  for (r->n = 0; p < e; r->n++) {
+    int len;
+    unsigned ucs = fl_utf8decode(p, e, &len);
+    p += len;
+    r->glyphs[r->n] = XftCharIndex(fl_display, desc->font, ucs);
+  }
+  r->hash_next = *bucket;
+  *bucket = r;
+  r->prev = 0;
+  r->next = first_run;
+  if (first_run) first_run->prev = r; else last_run = r;
+  first_run = r;
+  glyph_runs++;
+  return r;
+}
+
 static void utf8extents(Fl_Font_Descriptor *desc, const char *str, int n, XGlyphInfo *extents)
 {
+  XftFont *font = xft_font(desc);
+  Fl_Glyph_Run *r = glyph_run(desc, str, n);
+  if (r) {
+    if (!r->have_extents) {
+      XftGlyphExtents(fl_display, font, r->glyphs, r->n, &r->extents);
+      r->have_extents = 1;
+    }
+    *extents = r->extents;
+    return;
+  }
   memset(extents, 0, sizeof(XGlyphInfo));
   const wchar_t *buffer = utf8reformat(str, n);
 #ifdef __CYGWIN__
-    XftTextExtents16(fl_display, desc->font, (XftChar16 *)buffer, n, extents);
+    XftTextExtents16(fl_display, font, (XftChar16 *)buffer, n, extents);
 #else
-    XftTextExtents32(fl_display, desc->font, (XftChar32 *)buffer, n, extents);
+    XftTextExtents32(fl_display, font, (XftChar32 *)buffer, n, extents);
 #endif
 }
 
 int Fl_Xlib_Graphics_Driver::height() {
-  if (font_descriptor()) return font_descriptor()->font->ascent + font_descriptor()->font->descent;
+  if (font_descriptor()) {
+    XftFont *font = xft_font(font_descriptor());
+    return font->ascent + font->descent;
+  }
   else return -1;
 }
 
 int Fl_Xlib_Graphics_Driver::descent() {
-  if (font_descriptor()) return font_descriptor()->font->descent;
+  if (font_descriptor()) return xft_font(font_descriptor())->descent;
   else return -1;
 }
 
@@ -399,7 +642,7 @@ double Fl_Xlib_Graphics_Driver::width(const char* str, int n) {
 static double fl_xft_width(Fl_Font_Descriptor *desc, FcChar32 *str, int n) {
   if (!desc) return -1.0;
   XGlyphInfo i;
-  XftTextExtents32(fl_display, desc->font, str, n, &i);
+  XftTextExtents32(fl_display, xft_font(desc), str, n, &i);
   return i.xOff;
 }
 
@@ -529,7 +772,7 @@ static XFontStruct* fl_xxfont(Fl_Graphics_Driver *driver) {
   }
   return xgl_font;
 #  else // XFT-1 provides a means to load a "core" font directly
-  if (driver->font_descriptor()->font->core) {
+  if (xft_font(driver->font_descriptor())->core) {
     return driver->font_descriptor()->font->u.core.font; // is the current font a "core" font? If so, use it.
     }
   static XftFont* xftfont;
@@ -573,6 +816,7 @@ void fl_destroy_xft_draw(Window id) {
 }
 
 void Fl_Xlib_Graphics_Driver::draw(const char *str, int n, int x, int y) {
+  fl_sync_gc();
   if ( !this->font_descriptor() ) {
     this->font(FL_HELVETICA, FL_NORMAL_SIZE);
   }
@@ -606,11 +850,17 @@ void Fl_Xlib_Graphics_Driver::draw(const char *str, int n, int x, int y) {
   color.color.blue  = ((int)b)*0x101;
   color.color.alpha = 0xffff;
   
+  XftFont *font = xft_font(font_descriptor());
+  Fl_Glyph_Run *run = glyph_run(font_descriptor(), str, n);
+  if (run) {
+    XftDrawGlyphs(draw_, &color, font, x, y, run->glyphs, run->n);
+    return;
+  }
   const wchar_t *buffer = utf8reformat(str, n);
 #ifdef __CYGWIN__
-  XftDrawString16(draw_, &color, font_descriptor()->font, x, y, (XftChar16 *)buffer, n);
+  XftDrawString16(draw_, &color, font, x, y, (XftChar16 *)buffer, n);
 #else
-  XftDrawString32(draw_, &color, font_descriptor()->font, x, y, (XftChar32 *)buffer, n);
+  XftDrawString32(draw_, &color, font, x, y, (XftChar32 *)buffer, n);
 #endif
 }
 
@@ -621,6 +871,7 @@ void Fl_Xlib_Graphics_Driver::draw(int angle, const char *str, int n, int x, int
 }
 
 static void fl_drawUCS4(Fl_Graphics_Driver *driver, const FcChar32 *str, int n, int x, int y) {
+  fl_sync_gc();
 #if USE_OVERLAY
   XftDraw*& draw_ = fl_overlay ? draw_overlay : ::draw_;
   if (fl_overlay) {
@@ -651,7 +902,7 @@ static void fl_drawUCS4(Fl_Graphics_Driver *driver, const FcChar32 *str, int n,
   color.color.blue  = ((int)b)*0x101;
   color.color.alpha = 0xffff;
 
-  XftDrawString32(draw_, &color, driver->font_descriptor()->font, x, y, (FcChar32 *)str, n);
+  XftDrawString32(draw_, &color, xft_font(driver->font_descriptor()), x, y, (FcChar32 *)str, n);
 }
 
 
@@ -41,7 +41,7 @@
 // the extra image formats that aren't part of the core FLTK library.
 //
 
-static Fl_Image	*fl_check_images(const char *name, uchar *header, int headerlen);
+Fl_Image	*fl_check_images(const char *name, uchar *header, int headerlen);
 
 
 /**
@@ -85,7 +85,7 @@ fl_check_images(const char *name,		// I - Filename
 					// Start-of-Image
       header[3] >= 0xc0 && header[3] <= 0xef)
 	   				// APPn for JPEG file
-    return new Fl_JPEG_Image(name);
+    return Fl_JPEG_Image::shared_(name);	// may be reduced for get(name, W, H)
 #endif // HAVE_LIBJPEG
 
   return 0;
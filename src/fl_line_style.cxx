@@ -33,6 +33,10 @@
 // FIXME: this would probably better be in class Fl::
 int fl_line_width_ = 0;
 
+#ifdef USE_X11
+void fl_sync_gc(); // from fl_rect.cxx
+#endif
+
 #ifdef __APPLE_QUARTZ__
 float fl_quartz_line_width_ = 1.0f;
 static /*enum*/ CGLineCap fl_quartz_line_cap_ = kCGLineCapButt;
@@ -54,6 +58,7 @@ void Fl_Graphics_Driver::line_style(int style, int width, char* dashes) {
   else fl_line_width_ = width>0 ? width : -width;
 
 #if defined(USE_X11)
+  fl_sync_gc();
   int ndashes = dashes ? strlen(dashes) : 0;
   // emulate the WIN32 dash patterns on X
   char buf[7];
@@ -0,0 +1,350 @@
+//
+// "$Id$"
+//
+// Bulk plotting functions for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2016 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+/**
+  \file fl_plot.cxx
+  \brief Drawing of polylines, step plots and scatter plots from arrays.
+*/
+
+// The points are transformed in blocks with single precision, which the
+// compiler can vectorize, and then reduced before they are handed to the
+// graphics driver:
+//
+//  - consecutive points in the same pixel column are replaced by the
+//    first, minimum, maximum, and last point of the column,
+//  - segments are clipped against the clip box, so only their visible
+//    parts are drawn, and points far outside don't overflow the 16-bit
+//    coordinates of the X server,
+//  - scatter plot markers are drawn only once per pixel and culled
+//    against the clip box.
+//
+// This gives the same pixels as drawing all points, but a 1M-sample
+// waveform is drawn with a few thousand vertices.
+
+#include <FL/fl_draw.H>
+#include <FL/x.H>
+#include <FL/Fl.H>
+#include <FL/math.h>
+#include "flstring.h"
+#include <stdlib.h>
+
+extern int fl_line_width_; // from fl_line_style.cxx
+
+enum { PLOT_LINE, PLOT_STEP, PLOT_SCATTER };
+
+#define PLOT_BLOCK 1024		// points transformed at once
+#define PLOT_MAX 32000		// clip box used if there is no clip region
+
+
+//
+// Loads a block of coordinates as floats; a NULL array means the
+// coordinate is the index of the point...
+//
+
+static void plot_load(const void *src, int is_int, int i0, int n, float *dst) {
+  int i;
+  if (!src) {
+    for (i = 0; i < n; i ++) dst[i] = (float)(i0 + i);
+  } else if (is_int) {
+    const int *s = (const int *)src + i0;
+    for (i = 0; i < n; i ++) dst[i] = (float)s[i];
+  } else {
+    memcpy(dst, (const float *)src + i0, n * sizeof(float));
+  }
+}
+
+
+//
+// Transforms a block of points to device coordinates.
+// ok[i] is cleared for points with a NaN or infinite coordinate...
+//
+
+static void plot_transform(const float *x, const float *y, int n,
+                           const float *m, float *X, float *Y, uchar *ok) {
+  float a = m[0], b = m[1], c = m[2], d = m[3], tx = m[4], ty = m[5];
+
+  for (int i = 0; i < n; i ++) {
+    float fx = x[i] * a + y[i] * c + tx;
+    float fy = x[i] * b + y[i] * d + ty;
+    X[i]  = fx;
+    Y[i]  = fy;
+    ok[i] = (uchar)((fx - fx == 0.0f) & (fy - fy == 0.0f));
+  }
+}
+
+// Rounds a device coordinate to the nearest pixel:
+static inline int plot_round(double v) {
+  return (int)floor(v + 0.5);
+}
+
+
+//
+// Fl_Plot_Line clips the segments of a polyline against the clip box,
+// reduces the vertices of the visible parts, and sends the remaining
+// ones to the graphics driver...
+//
+
+class Fl_Plot_Line {
+  Fl_Graphics_Driver *driver;
+  double bx0, by0, bx1, by1;		// clip box
+  int np, pc;				// previous point and its outcode
+  double px, py;
+  int run, cx, first, last, lo, hi;	// current pixel column
+  int lo_seq, hi_seq, seq;		// order of minimum and maximum
+  int nv, vx, vy;			// vertices sent to the driver
+
+  int outcode(double x, double y) {
+    return (x < bx0) | ((x > bx1) << 1) | ((y < by0) << 2) | ((y > by1) << 3);
+  }
+
+  // Liang-Barsky clipping of the parameter range t0..t1 of a segment
+  // against one edge, returns 0 if the segment is outside:
+  static int clip_t(double p, double q, double &t0, double &t1) {
+    if (p == 0.0) return q >= 0.0;
+    double r = q / p;
+    if (p < 0.0) {
+      if (r > t1) return 0;
+      if (r > t0) t0 = r;
+    } else {
+      if (r < t0) return 0;
+      if (r < t1) t1 = r;
+    }
+    return 1;
+  }
+
+  void vertex(int x, int y) {
+    if (nv && x == vx && y == vy) return;
+    if (!nv) driver->begin_line();
+    driver->transformed_vertex(x, y);
+    vx = x; vy = y; nv ++;
+  }
+
+  void end_column() {
+    if (!run) return;
+    vertex(cx, first);
+    if (lo_seq < hi_seq) { vertex(cx, lo); vertex(cx, hi); }
+    else { vertex(cx, hi); vertex(cx, lo); }
+    vertex(cx, last);
+    run = 0;
+  }
+
+  void column(double fx, double fy) {
+    int x = plot_round(fx), y = plot_round(fy);
+    if (run && x == cx) {
+      last = y;
+      if (y < lo) { lo = y; lo_seq = ++seq; }
+      else if (y > hi) { hi = y; hi_seq = ++seq; }
+      return;
+    }
+    end_column();
+    run = 1;
+    cx = x;
+    first = last = lo = hi = y;
+    lo_seq = hi_seq = seq = 0;
+  }
+
+  // Ends the line that is drawn, if any:
+  void end_line() {
+    end_column();
+    if (nv) driver->end_line();
+    nv = 0;
+  }
+
+public:
+
+  Fl_Plot_Line(Fl_Graphics_Driver *d) {
+    driver = d;
+    np = run = nv = 0;
+
+    // Lines are clipped against the clip box, enlarged by the line width
+    // so that the ends of the clipped lines are not visible...
+    int X, Y, W, H;
+    d->clip_box(-PLOT_MAX, -PLOT_MAX, 2 * PLOT_MAX, 2 * PLOT_MAX, X, Y, W, H);
+    int margin = (fl_line_width_ > 1 ? fl_line_width_ : 1) + 1;
+    bx0 = X - margin; by0 = Y - margin;
+    bx1 = X + W + margin; by1 = Y + H + margin;
+  }
+
+  void add(double x, double y) {
+    int c = outcode(x, y);
+    if (!np) {
+      if (!c) column(x, y);
+    } else if (!(pc | c)) {
+      column(x, y);			// inside, the line continues
+    } else if (!(pc & c)) {
+      // the segment crosses the clip box, draw the visible part:
+      double t0 = 0.0, t1 = 1.0, dx = x - px, dy = y - py;
+      if (clip_t(-dx, px - bx0, t0, t1) && clip_t(dx, bx1 - px, t0, t1) &&
+          clip_t(-dy, py - by0, t0, t1) && clip_t(dy, by1 - py, t0, t1)) {
+        if (pc) column(px + t0 * dx, py + t0 * dy);	// enters the box
+        column(px + t1 * dx, py + t1 * dy);
+      }
+      if (c) end_line();		// leaves the box
+    }
+    np = 1; px = x; py = y; pc = c;
+  }
+
+  void gap() {
+    end_line();
+    np = 0;
+  }
+};
+
+
+//
+// 'Fl_Graphics_Driver::plot()' - Common code of all plotting functions.
+//
+
+void Fl_Graphics_Driver::plot(const void *x, const void *y, int is_int,
+                              int n, int mode, int size) {
+  if (n <= 0 || !y) return;
+
+  float	m[6];
+  m[0] = (float)transform_dx(1, 0);
+  m[1] = (float)transform_dy(1, 0);
+  m[2] = (float)transform_dx(0, 1);
+  m[3] = (float)transform_dy(0, 1);
+  m[4] = (float)transform_x(0, 0);
+  m[5] = (float)transform_y(0, 0);
+
+  float	*fx = new float[2 * PLOT_BLOCK];
+  float	*fy = new float[2 * PLOT_BLOCK];
+  float	*X = new float[2 * PLOT_BLOCK];
+  float	*Y = new float[2 * PLOT_BLOCK];
+  uchar	*ok = new uchar[2 * PLOT_BLOCK];
+
+  if (mode == PLOT_SCATTER) {
+    // Markers are culled against the clip box, and a bitmap of the clip
+    // box remembers which pixels already have a marker...
+    int bx, by, bw, bh;
+    clip_box(-PLOT_MAX, -PLOT_MAX, 2 * PLOT_MAX, 2 * PLOT_MAX, bx, by, bw, bh);
+    if (size < 1) size = 1;
+    int half = size / 2;
+    bx -= size - half; by -= size - half; bw += size; bh += size;
+
+    uchar *used = 0;
+    if (n > PLOT_BLOCK && (long)bw * bh <= (1L << 24))
+      used = (uchar *)calloc(((long)bw * bh + 7) / 8, 1);
+
+    int px = 0, py = 0, np = 0;
+
+    fl_begin_batch();
+    for (int i0 = 0; i0 < n; i0 += PLOT_BLOCK) {
+      int nb = n - i0 < PLOT_BLOCK ? n - i0 : PLOT_BLOCK;
+      plot_load(x, is_int, i0, nb, fx);
+      plot_load(y, is_int, i0, nb, fy);
+      plot_transform(fx, fy, nb, m, X, Y, ok);
+
+      for (int i = 0; i < nb; i ++) {
+        if (!ok[i] || X[i] < bx - 1 || Y[i] < by - 1 ||
+            X[i] > bx + bw || Y[i] > by + bh) continue;
+        int ix = plot_round(X[i]), iy = plot_round(Y[i]);
+        int xx = ix - bx, yy = iy - by;
+        if (xx < 0 || yy < 0 || xx >= bw || yy >= bh) continue;
+        if (used) {
+          long bit = (long)yy * bw + xx;
+          if (used[bit >> 3] & (1 << (bit & 7))) continue;
+          used[bit >> 3] |= (uchar)(1 << (bit & 7));
+        } else {
+          if (np && ix == px && iy == py) continue;
+          px = ix; py = iy; np = 1;
+        }
+        if (size == 1) point(ix, iy);
+        else rectf(ix - half, iy - half, size, size);
+      }
+    }
+    fl_end_batch();
+
+    if (used) free(used);
+  } else {
+    Fl_Plot_Line line(this);
+    float prev_y = 0.0f;
+    int have_prev = 0;
+
+    for (int i0 = 0; i0 < n; i0 += PLOT_BLOCK) {
+      int nb = n - i0 < PLOT_BLOCK ? n - i0 : PLOT_BLOCK;
+      plot_load(x, is_int, i0, nb, fx);
+      plot_load(y, is_int, i0, nb, fy);
+
+      if (mode == PLOT_STEP) {
+        // Insert the corner point (x[i], y[i-1]) before each point, the
+        // copy is done backwards so that the arrays can be expanded in
+        // place...
+        for (int i = nb - 1; i >= 0; i --) {
+          fx[2 * i + 1] = fx[i];
+          fy[2 * i + 1] = fy[i];
+          fx[2 * i]     = fx[i];
+          fy[2 * i]     = i ? fy[i - 1] : (have_prev ? prev_y : fy[i]);
+        }
+        prev_y = fy[2 * nb - 1];
+        have_prev = (prev_y == prev_y);
+        nb *= 2;
+      }
+
+      plot_transform(fx, fy, nb, m, X, Y, ok);
+
+      for (int i = 0; i < nb; i ++) {
+        if (ok[i]) line.add(X[i], Y[i]);
+        else line.gap();	// NaN coordinates break the line
+      }
+    }
+
+    line.gap();
+  }
+
+  delete[] fx;
+  delete[] fy;
+  delete[] X;
+  delete[] Y;
+  delete[] ok;
+}
+
+
+/** see fl_polyline(const float *x, const float *y, int n) */
+void Fl_Graphics_Driver::polyline(const float *x, const float *y, int n) {
+  plot(x, y, 0, n, PLOT_LINE, 0);
+}
+
+/** see fl_polyline(const int *x, const int *y, int n) */
+void Fl_Graphics_Driver::polyline(const int *x, const int *y, int n) {
+  plot(x, y, 1, n, PLOT_LINE, 0);
+}
+
+/** see fl_step_plot(const float *x, const float *y, int n) */
+void Fl_Graphics_Driver::step_plot(const float *x, const float *y, int n) {
+  plot(x, y, 0, n, PLOT_STEP, 0);
+}
+
+/** see fl_step_plot(const int *x, const int *y, int n) */
+void Fl_Graphics_Driver::step_plot(const int *x, const int *y, int n) {
+  plot(x, y, 1, n, PLOT_STEP, 0);
+}
+
+/** see fl_scatter(const float *x, const float *y, int n, int size) */
+void Fl_Graphics_Driver::scatter(const float *x, const float *y, int n, int size) {
+  plot(x, y, 0, n, PLOT_SCATTER, size);
+}
+
+/** see fl_scatter(const int *x, const int *y, int n, int size) */
+void Fl_Graphics_Driver::scatter(const int *x, const int *y, int n, int size) {
+  plot(x, y, 1, n, PLOT_SCATTER, size);
+}
+
+//
+// End of "$Id$".
+//
@@ -177,6 +177,8 @@ fl_read_image(uchar *p,		// I - Pixel buffer or NULL to allocate
 #    include <stdlib.h>
 #  endif // __sgi
 
+void fl_sync_gc(); // from fl_rect.cxx
+
 // Defined in fl_color.cxx
 extern uchar fl_redmask, fl_greenmask, fl_bluemask;
 extern int fl_redshift, fl_greenshift, fl_blueshift, fl_extrashift;
@@ -246,6 +248,9 @@ static uchar *read_win_rectangle(uchar *p, int X, int Y, int w, int h, int alpha
   int allow_outside = w < 0;    // negative w allows negative X or Y, that is, window frame
   if (w < 0) w = - w;
 
+  // Queued fl_begin_batch() primitives must be drawn before reading...
+  fl_sync_gc();
+
 #  ifdef __sgi
   if (XReadDisplayQueryExtension(fl_display, &i, &i)) {
     image = XReadDisplay(fl_display, fl_window, X, Y, w, h, 0, NULL);
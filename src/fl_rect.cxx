@@ -45,6 +45,22 @@ extern float fl_quartz_line_width_;
 
 #ifdef USE_X11
 
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_X11_XREGION_H
+#  include <X11/Xregion.h>
+#else // if the X11/Xregion.h header is not available, we assume this is the layout of an X11 Region:
+typedef struct {
+  short x1, x2, y1, y2;
+} BOX;
+struct _XRegion {
+  long size;
+  long numRects;
+  BOX *rects;
+  BOX extents;
+};
+#endif // HAVE_X11_XREGION_H
+
 #ifndef SHRT_MAX
 #define SHRT_MAX (32767)
 #endif
@@ -152,13 +168,202 @@ static int clip_x (int x) {
   return x;
 }
 
+/*
+  Batched drawing, see fl_begin_batch().
+
+  Between fl_begin_batch() and fl_end_batch() filled rectangles, single
+  lines, and points are queued and sent with one XFillRectangles(),
+  XDrawSegments(), or XDrawPoints() request. All queued primitives use
+  the same drawable and GC state, so the order in which they are drawn
+  doesn't matter. The queues are flushed before anything changes that
+  state (color, line style, clip region, drawable, or GC) and before any
+  other drawing operation of the X11 driver.
+*/
+
+#define BATCH_MAX 1024	// queue size, about 8 kB per queue
+
+static int batch_level = 0;		// fl_begin_batch() nesting level
+static int batch_pending = 0;		// number of queued primitives
+static Window batch_window;		// drawable of queued primitives
+static GC batch_gc;			// GC of queued primitives
+static ulong batch_pixel;		// current foreground pixel
+static XRectangle batch_rects[BATCH_MAX];
+static XSegment batch_segments[BATCH_MAX];
+static XPoint batch_points[BATCH_MAX];
+static int batch_nrects = 0, batch_nsegments = 0, batch_npoints = 0;
+
+// Draws all queued primitives:
+static void draw_batch() {
+  if (!batch_pending) return;
+  if (batch_nrects)
+    XFillRectangles(fl_display, batch_window, batch_gc, batch_rects, batch_nrects);
+  if (batch_nsegments)
+    XDrawSegments(fl_display, batch_window, batch_gc, batch_segments, batch_nsegments);
+  if (batch_npoints)
+    XDrawPoints(fl_display, batch_window, batch_gc, batch_points, batch_npoints, CoordModeOrigin);
+  batch_nrects = batch_nsegments = batch_npoints = batch_pending = 0;
+}
+
+/*
+  fl_batch_color() must be called before the foreground of fl_gc is
+  changed. The queues are flushed only if the color really changes.
+*/
+void fl_batch_color(ulong pixel) {
+  if (batch_pending && pixel != batch_pixel) draw_batch();
+  batch_pixel = pixel;
+}
+
+/*
+  Lazy clipping.
+
+  fl_push_clip(), fl_pop_clip(), and fl_clip_region() don't send the
+  new clip region to the X server, they only mark it as changed. The
+  clip region of fl_gc is updated by apply_clip() when something is
+  actually drawn, so widgets that push a clip but draw nothing don't
+  cost any requests. The rectangles of the clip region last sent are
+  kept, so the request is also skipped if the same clip is set again.
+*/
+
+#define CLIP_MAX 16	// clip rectangles remembered by apply_clip()
+
+static int clip_serial = 1;		// incremented when the clip changes
+static int clip_applied = 0;		// clip_serial of the clip in clip_gc
+static GC clip_gc;			// GC the clip was sent to
+static Fl_Graphics_Driver *clip_driver;	// driver of the clip that was sent
+static int clip_nrects = -2;		// rectangles sent, -1 = none, -2 = unknown
+static XRectangle clip_rects[CLIP_MAX];
+
+// Sends the current clip region to fl_gc if it has changed:
+static void apply_clip() {
+  if (clip_applied == clip_serial && clip_gc == fl_gc &&
+      clip_driver == fl_graphics_driver) return;
+  if (!fl_gc) return;
+
+  Fl_Region r = fl_clip_region();
+  XRectangle rects[CLIP_MAX];
+  int n = -1;
+
+  if (r && r->numRects <= CLIP_MAX) {
+    n = (int)r->numRects;
+    for (int i = 0; i < n; i ++) {
+      rects[i].x      = r->rects[i].x1;
+      rects[i].y      = r->rects[i].y1;
+      rects[i].width  = r->rects[i].x2 - r->rects[i].x1;
+      rects[i].height = r->rects[i].y2 - r->rects[i].y1;
+    }
+  } else if (r) n = -2;
+
+  if (n == -2 || clip_gc != fl_gc || n != clip_nrects ||
+      (n > 0 && memcmp(rects, clip_rects, n * sizeof(XRectangle)))) {
+    draw_batch();	// queued primitives use the old clip
+    if (n == -2) XSetRegion(fl_display, fl_gc, r);
+    else if (n == -1) XSetClipMask(fl_display, fl_gc, None);
+    else XSetClipRectangles(fl_display, fl_gc, 0, 0, rects, n, Unsorted);
+    if (n > 0) memcpy(clip_rects, rects, n * sizeof(XRectangle));
+    clip_nrects = n;
+  }
+
+  clip_applied = clip_serial;
+  clip_gc      = fl_gc;
+  clip_driver  = fl_graphics_driver;
+}
+
+/*
+  fl_sync_gc() sends all queued primitives and the current clip region
+  to the X server. It must be called before drawing directly on fl_gc.
+*/
+void fl_sync_gc() {
+  apply_clip();
+  draw_batch();
+}
+
+/*
+  fl_forget_gc() must be called before a GC is freed. It draws the
+  queued primitives, and makes sure that the clip region is sent again
+  if a new GC gets the same id.
+*/
+void fl_forget_gc(GC gc) {
+  if (batch_pending && batch_gc == gc) draw_batch();
+  if (clip_gc == gc) clip_gc = 0;
+}
+
+// Returns non-zero if primitives are to be queued, and makes sure that
+// the queues contain only primitives for the current drawable and GC.
+// The clip region is updated in any case:
+static inline int batching() {
+  if (batch_pending && (fl_window != batch_window || fl_gc != batch_gc))
+    draw_batch();
+  apply_clip();
+  if (!batch_level) return 0;
+  batch_window = fl_window;
+  batch_gc     = fl_gc;
+  return 1;
+}
+
+static void batch_rect(int x, int y, int w, int h) {
+  if (batch_nrects == BATCH_MAX) draw_batch();
+  XRectangle *r = batch_rects + batch_nrects++;
+  r->x = x; r->y = y; r->width = w; r->height = h;
+  batch_pending++;
+}
+
+static void batch_segment(int x, int y, int x1, int y1) {
+  if (batch_nsegments == BATCH_MAX) draw_batch();
+  XSegment *s = batch_segments + batch_nsegments++;
+  s->x1 = x; s->y1 = y; s->x2 = x1; s->y2 = y1;
+  batch_pending++;
+}
+
+static void batch_point(int x, int y) {
+  if (batch_npoints == BATCH_MAX) draw_batch();
+  XPoint *p = batch_points + batch_npoints++;
+  p->x = x; p->y = y;
+  batch_pending++;
+}
+
 #endif	// USE_X11
 
+/**
+  Starts batched drawing.
+
+  Until the matching fl_end_batch(), fl_rectf(), fl_point(), fl_line()
+  with two points, and fl_xyline() / fl_yxline() with a single segment
+  are collected and drawn with as few requests to the X server as
+  possible. This can make drawing of many small primitives, e.g. the
+  bars or segments of a chart, much faster.
+
+  The collected primitives are drawn automatically before the color,
+  line style, or clip region changes and before any other FLTK drawing
+  function is used, so the result is the same as without batching.
+  However, drawing with Xlib functions directly on fl_gc must be
+  preceded by fl_end_batch() or fl_restore_clip().
+
+  Calls can be nested. This does nothing on other platforms than X11.
+  \see fl_end_batch()
+*/
+void fl_begin_batch() {
+#ifdef USE_X11
+  batch_level++;
+#endif
+}
+
+/**
+  Ends batched drawing started with fl_begin_batch() and draws all
+  collected primitives.
+*/
+void fl_end_batch() {
+#ifdef USE_X11
+  if (batch_level > 0) batch_level--;
+  fl_sync_gc();
+#endif
+}
+
 
 void Fl_Graphics_Driver::rect(int x, int y, int w, int h) {
 
   if (w<=0 || h<=0) return;
 #if defined(USE_X11)
+  fl_sync_gc();
   if (!clip_to_short(x, y, w, h))
     XDrawRectangle(fl_display, fl_window, fl_gc, x, y, w-1, h-1);
 #elif defined(WIN32)
@@ -180,8 +385,9 @@ void Fl_Graphics_Driver::rect(int x, int y, int w, int h) {
 void Fl_Graphics_Driver::rectf(int x, int y, int w, int h) {
   if (w<=0 || h<=0) return;
 #if defined(USE_X11)
-  if (!clip_to_short(x, y, w, h))
-    XFillRectangle(fl_display, fl_window, fl_gc, x, y, w, h);
+  if (clip_to_short(x, y, w, h)) return;
+  if (batching()) batch_rect(x, y, w, h);
+  else XFillRectangle(fl_display, fl_window, fl_gc, x, y, w, h);
 #elif defined(WIN32)
   RECT rect;
   rect.left = x; rect.top = y;  
@@ -197,7 +403,8 @@ void Fl_Graphics_Driver::rectf(int x, int y, int w, int h) {
 
 void Fl_Graphics_Driver::xyline(int x, int y, int x1) {
 #if defined(USE_X11)
-  XDrawLine(fl_display, fl_window, fl_gc, clip_x(x), clip_x(y), clip_x(x1), clip_x(y));
+  if (batching()) batch_segment(clip_x(x), clip_x(y), clip_x(x1), clip_x(y));
+  else XDrawLine(fl_display, fl_window, fl_gc, clip_x(x), clip_x(y), clip_x(x1), clip_x(y));
 #elif defined(WIN32)
   MoveToEx(fl_gc, x, y, 0L); LineTo(fl_gc, x1+1, y);
 #elif defined(__APPLE_QUARTZ__)
@@ -224,6 +431,7 @@ void Fl_Graphics_Driver::xyline(int x, int y, int x1, int y2) {
   XPoint p[3];
   p[0].x = clip_x(x);  p[0].y = p[1].y = clip_x(y);
   p[1].x = p[2].x = clip_x(x1); p[2].y = clip_x(y2);
+  fl_sync_gc();
   XDrawLines(fl_display, fl_window, fl_gc, p, 3, 0);
 #elif defined(WIN32)
   if (y2 < y) y2--;
@@ -253,6 +461,7 @@ void Fl_Graphics_Driver::xyline(int x, int y, int x1, int y2, int x3) {
   p[0].x = clip_x(x);  p[0].y = p[1].y = clip_x(y);
   p[1].x = p[2].x = clip_x(x1); p[2].y = p[3].y = clip_x(y2);
   p[3].x = clip_x(x3);
+  fl_sync_gc();
   XDrawLines(fl_display, fl_window, fl_gc, p, 4, 0);
 #elif defined(WIN32)
   if(x3 < x1) x3--;
@@ -280,7 +489,8 @@ void Fl_Graphics_Driver::xyline(int x, int y, int x1, int y2, int x3) {
 
 void Fl_Graphics_Driver::yxline(int x, int y, int y1) {
 #if defined(USE_X11)
-  XDrawLine(fl_display, fl_window, fl_gc, clip_x(x), clip_x(y), clip_x(x), clip_x(y1));
+  if (batching()) batch_segment(clip_x(x), clip_x(y), clip_x(x), clip_x(y1));
+  else XDrawLine(fl_display, fl_window, fl_gc, clip_x(x), clip_x(y), clip_x(x), clip_x(y1));
 #elif defined(WIN32)
   if (y1 < y) y1--;
   else y1++;
@@ -305,6 +515,7 @@ void Fl_Graphics_Driver::yxline(int x, int y, int y1, int x2) {
   XPoint p[3];
   p[0].x = p[1].x = clip_x(x);  p[0].y = clip_x(y);
   p[1].y = p[2].y = clip_x(y1); p[2].x = clip_x(x2);
+  fl_sync_gc();
   XDrawLines(fl_display, fl_window, fl_gc, p, 3, 0);
 #elif defined(WIN32)
   if (x2 > x) x2++;
@@ -334,6 +545,7 @@ void Fl_Graphics_Driver::yxline(int x, int y, int y1, int x2, int y3) {
   p[0].x = p[1].x = clip_x(x);  p[0].y = clip_x(y);
   p[1].y = p[2].y = clip_x(y1); p[2].x = p[3].x = clip_x(x2);
   p[3].y = clip_x(y3);
+  fl_sync_gc();
   XDrawLines(fl_display, fl_window, fl_gc, p, 4, 0);
 #elif defined(WIN32)
   if(y3<y1) y3--;
@@ -361,7 +573,8 @@ void Fl_Graphics_Driver::yxline(int x, int y, int y1, int x2, int y3) {
 
 void Fl_Graphics_Driver::line(int x, int y, int x1, int y1) {
 #if defined(USE_X11)
-  XDrawLine(fl_display, fl_window, fl_gc, x, y, x1, y1);
+  if (batching()) batch_segment(x, y, x1, y1);
+  else XDrawLine(fl_display, fl_window, fl_gc, x, y, x1, y1);
 #elif defined(WIN32)
   MoveToEx(fl_gc, x, y, 0L); 
   LineTo(fl_gc, x1, y1);
@@ -385,6 +598,7 @@ void Fl_Graphics_Driver::line(int x, int y, int x1, int y1, int x2, int y2) {
   p[0].x = x;  p[0].y = y;
   p[1].x = x1; p[1].y = y1;
   p[2].x = x2; p[2].y = y2;
+  fl_sync_gc();
   XDrawLines(fl_display, fl_window, fl_gc, p, 3, 0);
 #elif defined(WIN32)
   MoveToEx(fl_gc, x, y, 0L); 
@@ -412,6 +626,7 @@ void Fl_Graphics_Driver::loop(int x, int y, int x1, int y1, int x2, int y2) {
   p[1].x = x1; p[1].y = y1;
   p[2].x = x2; p[2].y = y2;
   p[3].x = x;  p[3].y = y;
+  fl_sync_gc();
   XDrawLines(fl_display, fl_window, fl_gc, p, 4, 0);
 #elif defined(WIN32)
   MoveToEx(fl_gc, x, y, 0L); 
@@ -439,6 +654,7 @@ void Fl_Graphics_Driver::loop(int x, int y, int x1, int y1, int x2, int y2, int
   p[2].x = x2; p[2].y = y2;
   p[3].x = x3; p[3].y = y3;
   p[4].x = x;  p[4].y = y;
+  fl_sync_gc();
   XDrawLines(fl_display, fl_window, fl_gc, p, 5, 0);
 #elif defined(WIN32)
   MoveToEx(fl_gc, x, y, 0L); 
@@ -467,6 +683,7 @@ void Fl_Graphics_Driver::polygon(int x, int y, int x1, int y1, int x2, int y2) {
   p[2].x = x2; p[2].y = y2;
 #if defined (USE_X11)
   p[3].x = x;  p[3].y = y;
+  fl_sync_gc();
   XFillPolygon(fl_display, fl_window, fl_gc, p, 3, Convex, 0);
   XDrawLines(fl_display, fl_window, fl_gc, p, 4, 0);
 #elif defined(WIN32)
@@ -493,6 +710,7 @@ void Fl_Graphics_Driver::polygon(int x, int y, int x1, int y1, int x2, int y2, i
   p[3].x = x3; p[3].y = y3;
 #if defined(USE_X11)
   p[4].x = x;  p[4].y = y;
+  fl_sync_gc();
   XFillPolygon(fl_display, fl_window, fl_gc, p, 4, Convex, 0);
   XDrawLines(fl_display, fl_window, fl_gc, p, 5, 0);
 #elif defined(WIN32)
@@ -514,7 +732,8 @@ void Fl_Graphics_Driver::polygon(int x, int y, int x1, int y1, int x2, int y2, i
 
 void Fl_Graphics_Driver::point(int x, int y) {
 #if defined(USE_X11)
-  XDrawPoint(fl_display, fl_window, fl_gc, clip_x(x), clip_x(y));
+  if (batching()) batch_point(clip_x(x), clip_x(y));
+  else XDrawPoint(fl_display, fl_window, fl_gc, clip_x(x), clip_x(y));
 #elif defined(WIN32)
   SetPixel(fl_gc, x, y, fl_RGB());
 #elif defined(__APPLE_QUARTZ__)
@@ -539,16 +758,109 @@ Fl_Region XRectangleRegion(int x, int y, int w, int h) {
 }
 #endif
 
+#if defined(USE_X11)
+/*
+  Clip regions of the X11 driver.
+
+  The regions of the clip stack are Xlib regions, but fl_push_clip()
+  fills them directly, since the intersection of a region and a
+  rectangle is simply the list of the intersections with each rectangle
+  of the region. Popped regions are kept in a small pool and reused, so
+  nested fl_push_clip() and fl_pop_clip() calls don't allocate memory.
+*/
+
+#define REGION_POOL_SIZE 16
+
+static Fl_Region region_pool[REGION_POOL_SIZE];
+static int region_pool_count = 0;
+
+// Returns an empty region with room for n rectangles:
+static Fl_Region new_region(long n) {
+  Fl_Region r = region_pool_count ? region_pool[--region_pool_count]
+                                  : XCreateRegion();
+  if (n > r->size) {
+    BOX *rects = (BOX *)realloc(r->rects, n * sizeof(BOX));
+    if (!rects) {
+      XDestroyRegion(r);
+      return XCreateRegion();
+    }
+    r->rects = rects;
+    r->size  = n;
+  }
+  r->numRects = 0;
+  r->extents.x1 = r->extents.x2 = r->extents.y1 = r->extents.y2 = 0;
+  return r;
+}
+
+// Puts a region that is no longer used back into the pool:
+static void free_region(Fl_Region r) {
+  if (!r) return;
+  if (region_pool_count < REGION_POOL_SIZE && r->size <= 64)
+    region_pool[region_pool_count++] = r;
+  else XDestroyRegion(r);
+}
+
+// Returns the intersection of a region (or everything if current is 0)
+// and a rectangle as a new region:
+static Fl_Region intersect_region_and_rect(Fl_Region current, int x, int y, int w, int h) {
+  if (clip_to_short(x, y, w, h)) return new_region(0);
+
+  short x1 = x, y1 = y, x2 = x + w, y2 = y + h;
+
+  if (!current) {
+    Fl_Region r = new_region(1);
+    BOX *b = r->rects;
+    b->x1 = x1; b->y1 = y1; b->x2 = x2; b->y2 = y2;
+    r->numRects = 1;
+    r->extents  = *b;
+    return r;
+  }
+
+  if (current->extents.x1 >= x2 || current->extents.x2 <= x1 ||
+      current->extents.y1 >= y2 || current->extents.y2 <= y1 ||
+      !current->numRects)
+    return new_region(0);
+
+  Fl_Region r = new_region(current->numRects);
+  BOX *b = r->rects;
+  BOX *c = current->rects;
+  BOX *end = c + current->numRects;
+
+  // The rectangles are sorted by y, so rectangles that are completely
+  // below the clip rectangle end the loop...
+  for (; c < end && c->y1 < y2; c ++) {
+    if (c->y2 <= y1 || c->x2 <= x1 || c->x1 >= x2) continue;
+    b->x1 = c->x1 > x1 ? c->x1 : x1;
+    b->y1 = c->y1 > y1 ? c->y1 : y1;
+    b->x2 = c->x2 < x2 ? c->x2 : x2;
+    b->y2 = c->y2 < y2 ? c->y2 : y2;
+    if (b == r->rects) r->extents = *b;
+    else {
+      if (b->x1 < r->extents.x1) r->extents.x1 = b->x1;
+      if (b->x2 > r->extents.x2) r->extents.x2 = b->x2;
+      r->extents.y2 = b->y2;
+    }
+    b ++;
+  }
+  r->numRects = b - r->rects;
+  return r;
+}
+#endif // USE_X11
+
 void Fl_Graphics_Driver::restore_clip() {
   fl_clip_state_number++;
+#if defined(USE_X11)
+  // The clip of fl_gc may have been changed by Xlib calls, so it is
+  // always sent again...
+  clip_serial ++;
+  clip_nrects = -2;
+  apply_clip();
+#else
   if (!fl_gc) return;
   Fl_Region r = rstack[rstackptr];
-#if defined(USE_X11)
-  if (r) XSetRegion(fl_display, fl_gc, r);
-  else XSetClipMask(fl_display, fl_gc, 0);
-#elif defined(WIN32)
+#  if defined(WIN32)
   SelectClipRgn(fl_gc, r); //if r is NULL, clip is automatically cleared
-#elif defined(__APPLE_QUARTZ__)
+#  elif defined(__APPLE_QUARTZ__)
   if ( fl_window || fl_gc ) { // clipping for a true window or an offscreen buffer
     Fl_X::q_clear_clipping();
     Fl_X::q_fill_context();//flip coords if bitmap context
@@ -557,16 +869,33 @@ void Fl_Graphics_Driver::restore_clip() {
       CGContextClipToRects(fl_gc, r->rects, r->count);
     }
   }
+#  else
+#    error unsupported platform
+#  endif
+#endif
+}
+
+// Called when the clip region changed, sends it to the graphics system
+// (on X11 this is done when something is drawn):
+static inline void clip_changed(int &clip_state_number) {
+#if defined(USE_X11)
+  clip_state_number ++;
+  clip_serial ++;
 #else
-# error unsupported platform
+  (void)clip_state_number;
+  fl_restore_clip();
 #endif
 }
 
 void Fl_Graphics_Driver::clip_region(Fl_Region r) {
   Fl_Region oldr = rstack[rstackptr];
+#if defined(USE_X11)
+  if (oldr != r) free_region(oldr);
+#else
   if (oldr) XDestroyRegion(oldr);
+#endif
   rstack[rstackptr] = r;
-  fl_restore_clip();
+  clip_changed(fl_clip_state_number);
 }
 
 Fl_Region Fl_Graphics_Driver::clip_region() {
@@ -576,26 +905,25 @@ Fl_Region Fl_Graphics_Driver::clip_region() {
 void Fl_Graphics_Driver::push_clip(int x, int y, int w, int h) {
   Fl_Region r;
   if (w > 0 && h > 0) {
+#if defined(USE_X11)
+    r = intersect_region_and_rect(rstack[rstackptr], x, y, w, h);
+#else
     r = XRectangleRegion(x,y,w,h);
     Fl_Region current = rstack[rstackptr];
     if (current) {
-#if defined(USE_X11)
-      Fl_Region temp = XCreateRegion();
-      XIntersectRegion(current, r, temp);
-      XDestroyRegion(r);
-      r = temp;
-#elif defined(WIN32)
+#  if defined(WIN32)
       CombineRgn(r,r,current,RGN_AND);
-#elif defined(__APPLE_QUARTZ__)
+#  elif defined(__APPLE_QUARTZ__)
       XDestroyRegion(r);
       r = Fl_X::intersect_region_and_rect(current, x,y,w,h);
-#else
-# error unsupported platform
-#endif
+#  else
+#    error unsupported platform
+#  endif
     }
+#endif
   } else { // make empty clip region:
 #if defined(USE_X11)
-    r = XCreateRegion();
+    r = new_region(0);
 #elif defined(WIN32)
     r = CreateRectRgn(0,0,0,0);
 #elif defined(__APPLE_QUARTZ__)
@@ -606,23 +934,27 @@ void Fl_Graphics_Driver::push_clip(int x, int y, int w, int h) {
   }
   if (rstackptr < region_stack_max) rstack[++rstackptr] = r;
   else Fl::warning("fl_push_clip: clip stack overflow!\n");
-  fl_restore_clip();
+  clip_changed(fl_clip_state_number);
 }
 
 // make there be no clip (used by fl_begin_offscreen() only!)
 void Fl_Graphics_Driver::push_no_clip() {
   if (rstackptr < region_stack_max) rstack[++rstackptr] = 0;
   else Fl::warning("fl_push_no_clip: clip stack overflow!\n");
-  fl_restore_clip();
+  clip_changed(fl_clip_state_number);
 }
 
 // pop back to previous clip:
 void Fl_Graphics_Driver::pop_clip() {
   if (rstackptr > 0) {
     Fl_Region oldr = rstack[rstackptr--];
+#if defined(USE_X11)
+    free_region(oldr);
+#else
     if (oldr) XDestroyRegion(oldr);
+#endif
   } else Fl::warning("fl_pop_clip: clip stack underflow!\n");
-  fl_restore_clip();
+  clip_changed(fl_clip_state_number);
 }
 
 int Fl_Graphics_Driver::not_clipped(int x, int y, int w, int h) {
@@ -670,14 +1002,19 @@ int Fl_Graphics_Driver::clip_box(int x, int y, int w, int h, int& X, int& Y, int
   default: // partial:
     break;
   }
-  Fl_Region rr = XRectangleRegion(x,y,w,h);
-  Fl_Region temp = XCreateRegion();
-  XIntersectRegion(r, rr, temp);
-  XRectangle rect;
-  XClipBox(temp, &rect);
-  X = rect.x; Y = rect.y; W = rect.width; H = rect.height;
-  XDestroyRegion(temp);
-  XDestroyRegion(rr);
+  // Bounding box of the intersections with the clip rectangles:
+  if (clip_to_short(x, y, w, h)) { W = H = 0; return 2; }
+  int x1 = x + w, y1 = y + h;
+  int bx = x1, by = y1, bx1 = x, by1 = y;
+  for (BOX *b = r->rects, *end = b + r->numRects; b < end && b->y1 < y1; b ++) {
+    if (b->y2 <= y || b->x2 <= x || b->x1 >= x1) continue;
+    if (b->x1 < bx) bx = b->x1 > x ? b->x1 : x;
+    if (b->y1 < by) by = b->y1 > y ? b->y1 : y;
+    if (b->x2 > bx1) bx1 = b->x2 < x1 ? b->x2 : x1;
+    if (b->y2 > by1) by1 = b->y2 < y1 ? b->y2 : y1;
+  }
+  if (bx1 <= bx || by1 <= by) { W = H = 0; return 2; }
+  X = bx; Y = by; W = bx1 - bx; H = by1 - by;
   return 1;
 #elif defined(WIN32)
 // The win32 API makes no distinction between partial and complete
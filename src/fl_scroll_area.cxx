@@ -25,6 +25,35 @@
 #include <FL/x.H>
 #include <FL/fl_draw.H>
 
+#ifdef USE_X11
+void fl_sync_gc(); // from fl_rect.cxx
+#  if USE_XDBE
+int fl_xdbe_in_use(); // from Fl_Double_Window.cxx
+#  endif
+
+// Returns non-zero if XCopyArea() within the drawable may generate
+// GraphicsExpose events. Parts of a window that are obscured or off
+// screen can't be copied, but pixmaps, i.e. offscreen drawing and the
+// back buffer of Fl_Double_Window, always have all pixels:
+static int copy_may_expose(Window d) {
+  for (Fl_X *i = Fl_X::first; i; i = i->next) {
+    if (i->xid == d) return 1;
+#  if USE_XDBE
+    if (i->other_xid == d) return fl_xdbe_in_use();
+#  else
+    if (i->other_xid == d) return 0;
+#  endif
+  }
+  return 0;
+}
+
+// Matches the GraphicsExpose and NoExpose events of a drawable:
+static Bool is_graphics_expose(Display *, XEvent *e, XPointer d) {
+  return (e->type == GraphicsExpose || e->type == NoExpose) &&
+         e->xgraphicsexpose.drawable == *(Drawable *)d;
+}
+#endif
+
 // scroll a rectangle and redraw the newly exposed portions:
 /**
   Scroll a rectangle and draw the newly exposed portions.
@@ -76,17 +105,22 @@ void fl_scroll(int X, int Y, int W, int H, int dx, int dy,
   }
 
 #if defined(USE_X11)
+  fl_sync_gc();
   XCopyArea(fl_display, fl_window, fl_window, fl_gc,
 	    src_x, src_y, src_w, src_h, dest_x, dest_y);
-  // we have to sync the display and get the GraphicsExpose events! (sigh)
-  for (;;) {
-    XEvent e; XWindowEvent(fl_display, fl_window, ExposureMask, &e);
-    if (e.type == NoExpose) break;
-    // otherwise assume it is a GraphicsExpose event:
-    draw_area(data, e.xexpose.x, e.xexpose.y,
-	      e.xexpose.width, e.xexpose.height);
-    if (!e.xgraphicsexpose.count) break;
+  if (copy_may_expose(fl_window)) {
+    // we have to sync the display and get the GraphicsExpose events! (sigh)
+    // Other events, e.g. Expose events of the window, stay in the queue.
+    Drawable d = fl_window;
+    for (;;) {
+      XEvent e; XIfEvent(fl_display, &e, is_graphics_expose, (XPointer)&d);
+      if (e.type == NoExpose) break;
+      draw_area(data, e.xgraphicsexpose.x, e.xgraphicsexpose.y,
+		e.xgraphicsexpose.width, e.xgraphicsexpose.height);
+      if (!e.xgraphicsexpose.count) break;
+    }
   }
+  // The NoExpose event of a pixmap is ignored by the event loop.
 #elif defined(WIN32)
   typedef int (WINAPI* fl_GetRandomRgn_func)(HDC, HRGN, INT);
   static fl_GetRandomRgn_func fl_GetRandomRgn = 0L;
@@ -17,6 +17,11 @@
 //
 
 #include <X11/Xft/Xft.h>
+#include <FL/filename.H>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdio.h>
 
 // This function fills in the fltk font table with all the fonts that
 // are found on the X server.  It tries to place the fonts into families
@@ -197,15 +202,126 @@ STYLE_DONE:
 
 static int fl_free_font = FL_FREE_FONT;
 
+/*
+  Listing all fonts with fontconfig takes a long time on systems with
+  thousands of fonts, so the sorted list of FLTK font names is kept in
+  an index file in $XDG_CACHE_HOME/fltk (or ~/.cache/fltk). The file
+  starts with a key computed from the fontconfig version and the paths
+  and modification times of the font and cache directories, and is
+  only used if the key still matches.
+*/
+
+#define FONT_INDEX_VERSION "FLTK font index 1"
+#define FONT_INDEX_MAX 1000000	// more names mean that the file is broken
+
+static char **font_index = 0;	// sorted FLTK font names
+static char *font_added = 0;	// non-zero if font_index[i] is in fl_fonts
+static int font_index_n = -1;	// -1 = not loaded yet
+
+static unsigned long hash_string(unsigned long h, const char *s) {
+  while (*s) h = (h ^ (uchar)*s++) * 16777619UL;
+  return h;
+}
+
+static unsigned long hash_dirs(unsigned long h, FcStrList *dirs) {
+  if (!dirs) return h;
+  FcChar8 *dir;
+  char buf[64];
+  while ((dir = FcStrListNext(dirs)) != 0) {
+    struct stat st;
+    h = hash_string(h, (const char *)dir);
+    if (!stat((const char *)dir, &st)) {
+      snprintf(buf, sizeof(buf), "%ld", (long)st.st_mtime);
+      h = hash_string(h, buf);
+    }
+  }
+  FcStrListDone(dirs);
+  return h;
+}
+
+// Returns the key of the current font configuration:
+static unsigned long fontconfig_key() {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%d", FcGetVersion());
+  unsigned long h = hash_string(2166136261UL, buf);
+  h = hash_dirs(h, FcConfigGetFontDirs(0));
+#if FC_VERSION >= 20900
+  h = hash_dirs(h, FcConfigGetCacheDirs(0));
+#endif
+  return h;
+}
+
+// Gets the name of the index file, returns 0 if there is no home directory:
+static int font_index_file(char *name, int size, int create_dir) {
+  const char *dir = fl_getenv("XDG_CACHE_HOME");
+  if (dir && *dir) {
+    snprintf(name, size, "%s/fltk", dir);
+  } else {
+    dir = fl_getenv("HOME");
+    if (!dir || !*dir) return 0;
+    snprintf(name, size, "%s/.cache", dir);
+    if (create_dir) mkdir(name, 0700);
+    strlcat(name, "/fltk", size);
+  }
+  if (create_dir) mkdir(name, 0700);
+  strlcat(name, "/fonts.idx", size);
+  return 1;
+}
+
+static int read_font_index(unsigned long key) {
+  char name[FL_PATH_MAX], line[LOCAL_RAW_NAME_MAX + 64];
+  if (!font_index_file(name, sizeof(name), 0)) return 0;
+  FILE *fp = fl_fopen(name, "r");
+  if (!fp) return 0;
+
+  unsigned long file_key;
+  int n;
+  if (!fgets(line, sizeof(line), fp) ||
+      strncmp(line, FONT_INDEX_VERSION " ", sizeof(FONT_INDEX_VERSION)) ||
+      sscanf(line + sizeof(FONT_INDEX_VERSION), "%lx %d", &file_key, &n) != 2 ||
+      file_key != key || n < 0 || n > FONT_INDEX_MAX) {
+    fclose(fp);
+    return 0;
+  }
+
+  char **list = (char **)calloc(n + 1, sizeof(char *));
+  if (!list) {
+    fclose(fp);
+    return 0;
+  }
+  int i;
+  for (i = 0; i < n && fgets(line, sizeof(line), fp); i++) {
+    line[strcspn(line, "\n")] = 0;
+    if (!(list[i] = strdup(line))) break;
+  }
+  fclose(fp);
+  if (i < n) {	// truncated file or out of memory
+    while (i > 0) free(list[--i]);
+    free(list);
+    return 0;
+  }
+  font_index = list;
+  font_index_n = n;
+  return 1;
+}
+
+static void write_font_index(unsigned long key) {
+  char name[FL_PATH_MAX], temp[FL_PATH_MAX + 24];
+  if (!font_index_file(name, sizeof(name), 1)) return;
+  if (snprintf(temp, sizeof(temp), "%s.%ld", name, (long)getpid()) >= (int)sizeof(temp))
+    return;
+  FILE *fp = fl_fopen(temp, "w");
+  if (!fp) return;
+  fprintf(fp, FONT_INDEX_VERSION " %lx %d\n", key, font_index_n);
+  for (int i = 0; i < font_index_n; i++) fprintf(fp, "%s\n", font_index[i]);
+  // replace the old index only if the new one is complete:
+  if (fclose(fp) || rename(temp, name)) unlink(temp);
+}
+
 // Uses the fontconfig lib to construct a list of all installed fonts.
 // I tried using XftListFonts for this, but the API is tricky - and when
 // I looked at the XftList* code, it calls the Fc* functions anyway, so...
-//
-// Also, for now I'm ignoring the "pattern_name" and just getting everything...
-// AND I don't try and skip the fonts we've already loaded in the defaults.
-// Blimey! What a hack!
-Fl_Font Fl::set_fonts(const char* pattern_name)
-{
+static void list_fonts() {
   FcFontSet  *fnt_set;     // Will hold the list of fonts we find
   FcPattern   *fnt_pattern; // Holds the generic "match all names" pattern
   FcObjectSet *fnt_obj_set = 0; // Holds the generic "match all objects"
@@ -214,24 +330,10 @@ Fl_Font Fl::set_fonts(const char* pattern_name)
   int font_count; // Total number of fonts found to process
   char **full_list; // The list of font names we build
 
-  if (fl_free_font > FL_FREE_FONT) // already been here
-    return (Fl_Font)fl_free_font;
-
-  fl_open_display(); // Just in case...
-
-  // Make sure fontconfig is ready... is this necessary? The docs say it is
-  // safe to call it multiple times, so just go for it anyway!
-  if (!FcInit())
-  {
-    // What to do? Just return defaults...
-    return FL_FREE_FONT;
-  }
+  font_index_n = 0;
 
   // Create a search pattern that will match every font name - I think this
   // does the Right Thing, but am not certain...
-  //
-  // This could possibly be "enhanced" to pay attention to the requested
-  // "pattern_name"?
   fnt_pattern = FcPatternCreate();
   fnt_obj_set = FcObjectSetBuild(FC_FAMILY, FC_STYLE, (void *)0);
 
@@ -313,27 +415,66 @@ Fl_Font Fl::set_fonts(const char* pattern_name)
     // Sort the list into alphabetic order
     qsort(full_list, font_count, sizeof(*full_list), name_sort);
 
-    // Now let us add the names we got to fltk's font list...
+    // Now let us make the list of fltk font names...
+    font_index = (char **)calloc(font_count + 1, sizeof(char *));
     for (j = 0; j < font_count; j++)
     {
       if (full_list[j])
       {
         char xft_name[LOCAL_RAW_NAME_MAX];
-        char *stored_name;
         // Parse the strings into FLTK-XFT style..
         make_raw_name(xft_name, full_list[j]);
-        // NOTE: This just adds on AFTER the default fonts - no attempt is made
-        // to identify already loaded fonts. Is this bad?
-        stored_name = strdup(xft_name);
-        Fl::set_font((Fl_Font)(j + FL_FREE_FONT), stored_name);
-        fl_free_font ++;
-
+        font_index[font_index_n++] = strdup(xft_name);
         free(full_list[j]); // release that name from our internal array
       }
     }
     // Now we are done with the list, release it fully
     free(full_list);
   }
+}
+
+// Adds the fonts found on the system to the fltk font table. With a
+// pattern that is not NULL, "*", or an X font name pattern ("-..."),
+// only the fonts with names that start with the pattern are added, and
+// the others can be added by calling this again with another pattern.
+Fl_Font Fl::set_fonts(const char* pattern_name)
+{
+  if (font_index_n >= 0 && fl_free_font - FL_FREE_FONT >= font_index_n) // already been here
+    return (Fl_Font)fl_free_font;
+
+  fl_open_display(); // Just in case...
+
+  // Make sure fontconfig is ready... is this necessary? The docs say it is
+  // safe to call it multiple times, so just go for it anyway!
+  if (!FcInit())
+  {
+    // What to do? Just return defaults...
+    return (Fl_Font)fl_free_font;
+  }
+
+  if (font_index_n < 0) {
+    unsigned long key = fontconfig_key();
+    if (!read_font_index(key)) {
+      list_fonts();
+      write_font_index(key);
+    }
+    font_added = (char *)calloc(font_index_n + 1, 1);
+  }
+
+  const char *prefix = pattern_name;
+  if (prefix && (!*prefix || *prefix == '-' || !strcmp(prefix, "*"))) prefix = 0;
+  int prefix_len = prefix ? (int) strlen(prefix) : 0;
+
+  // Now let us add the names we got to fltk's font list...
+  for (int j = 0; j < font_index_n; j++) {
+    if (font_added[j]) continue;
+    if (prefix && strncasecmp(font_index[j] + 1, prefix, prefix_len)) continue;
+    // NOTE: This just adds on AFTER the default fonts - no attempt is made
+    // to identify already loaded fonts. Is this bad?
+    Fl::set_font((Fl_Font)fl_free_font, font_index[j]);
+    fl_free_font ++;
+    font_added[j] = 1;
+  }
   return (Fl_Font)fl_free_font;
 } // ::set_fonts
 ////////////////////////////////////////////////////////////////
@@ -347,12 +488,34 @@ static int int_sort(const void *aa, const void *bb) {
 
 ////////////////////////////////////////////////////////////////
 
+// The sizes of each font are kept, since listing them takes a while:
+struct Fl_Font_Sizes {
+  char *name;		// copy of the font name when the sizes were listed
+  int *sizes;
+  int n;
+};
+
+static Fl_Font_Sizes *font_sizes = 0;
+static int font_sizes_n = 0;
+
 // Return all the point sizes supported by this font:
 // Suprisingly enough Xft works exactly like fltk does and returns
 // the same list. Except there is no way to tell if the font is scalable.
 int Fl::get_font_sizes(Fl_Font fnum, int*& sizep) {
   Fl_Fontdesc *s = fl_fonts+fnum;
-  if (!s->name) s = fl_fonts; // empty slot in table, use entry 0
+  if (!s->name) {s = fl_fonts; fnum = 0;} // empty slot in table, use entry 0
+
+  if (fnum >= font_sizes_n) {
+    int n = fnum + 64;
+    font_sizes = (Fl_Font_Sizes *)realloc(font_sizes, n * sizeof(Fl_Font_Sizes));
+    memset(font_sizes + font_sizes_n, 0, (n - font_sizes_n) * sizeof(Fl_Font_Sizes));
+    font_sizes_n = n;
+  }
+  Fl_Font_Sizes *m = font_sizes + fnum;
+  if (m->sizes && !strcmp(m->name, s->name)) {
+    sizep = m->sizes;
+    return m->n;
+  }
 
   fl_open_display();
   XftFontSet* fs = XftListFonts(fl_display, fl_screen,
@@ -360,12 +523,7 @@ int Fl::get_font_sizes(Fl_Font fnum, int*& sizep) {
 				(void *)0,
                                 XFT_PIXEL_SIZE,
 				(void *)0);
-  static int* array = 0;
-  static int array_size = 0;
-  if (fs->nfont >= array_size) {
-    delete[] array;
-    array = new int[array_size = fs->nfont+1];
-  }
+  int* array = new int[fs->nfont+1];
   array[0] = 0; int j = 1; // claim all fonts are scalable
   for (int i = 0; i < fs->nfont; i++) {
     double v;
@@ -375,6 +533,11 @@ int Fl::get_font_sizes(Fl_Font fnum, int*& sizep) {
   }
   qsort(array+1, j-1, sizeof(int), int_sort);
   XftFontSetDestroy(fs);
+  delete[] m->sizes;
+  free(m->name);
+  m->name = strdup(s->name);
+  m->sizes = array;
+  m->n = j;
   sizep = array;
   return j;
 }
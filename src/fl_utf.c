@@ -103,6 +103,26 @@ static unsigned short cp1252[32] = {
 };
 #endif
 
+/* Returns the number of ASCII bytes at the start of p..e. Most text is
+   mostly ASCII, so the converters below skip or copy such runs at once,
+   testing a machine word at a time. The loops are simple enough for the
+   compiler to vectorize them, and don't need any special instructions.
+*/
+static unsigned ascii_run(const char* p, const char* e)
+{
+  const char* s = p;
+  const size_t hi = ((size_t)-1 / 0xff) * 0x80; /* 0x8080...80 */
+  size_t w0, w1;
+  while (e - p >= (long)(2 * sizeof(size_t))) {
+    memcpy(&w0, p, sizeof(size_t));
+    memcpy(&w1, p + sizeof(size_t), sizeof(size_t));
+    if ((w0 | w1) & hi) break;
+    p += 2 * sizeof(size_t);
+  }
+  while (p < e && !(*p & 0x80)) p++;
+  return (unsigned)(p - s);
+}
+
 /*! Decode a single UTF-8 encoded character starting at \e p. The
     resulting Unicode value (in the range 0-0x10ffff) is returned,
     and \e len is set to the number of bytes in the UTF-8 encoding
@@ -208,6 +228,28 @@ unsigned fl_utf8decode(const char* p, const char* end, int* len)
   }
 }
 
+/* Same as fl_utf8decode(p,e,len) for p < e, with the common well-formed
+   2- and 3-byte sequences decoded inline...
+*/
+static unsigned utf8_next(const char* p, const char* e, int* len)
+{
+  const unsigned char* u = (const unsigned char*)p;
+  if (u[0] >= 0xc2 && u[0] < 0xe0) {
+    if (e - p >= 2 && (u[1]&0xc0) == 0x80) {
+      *len = 2;
+      return ((u[0] & 0x1f) << 6) + (u[1] & 0x3f);
+    }
+#if !STRICT_RFC3629
+  } else if (u[0] > 0xe0 && u[0] < 0xf0) {
+    if (e - p >= 3 && (u[1]&0xc0) == 0x80 && (u[2]&0xc0) == 0x80) {
+      *len = 3;
+      return ((u[0] & 0x0f) << 12) + ((u[1] & 0x3f) << 6) + (u[2] & 0x3f);
+    }
+#endif
+  }
+  return fl_utf8decode(p, e, len);
+}
+
 /*! Move \p p forward until it points to the start of a UTF-8
   character. If it already points at the start of one then it
   is returned unchanged. Any UTF-8 errors are treated as though each
@@ -438,9 +480,18 @@ unsigned fl_utf8toUtf16(const char* src, unsigned srclen,
   if (dstlen) for (;;) {
     if (p >= e) {dst[count] = 0; return count;}
     if (!(*p & 0x80)) { /* ascii */
+      if (p+1 < e && !(p[1] & 0x80)) {
+	unsigned i, n = ascii_run(p, e);
+	if (n > dstlen-1-count) n = dstlen-1-count;
+	if (n > 1) { /* copy all but the last one, which is done below */
+	  n--;
+	  for (i = 0; i < n; i++) dst[count+i] = (unsigned char)p[i];
+	  count += n; p += n;
+	}
+      }
       dst[count] = *p++;
     } else {
-      int len; unsigned ucs = fl_utf8decode(p,e,&len);
+      int len; unsigned ucs = utf8_next(p,e,&len);
       p += len;
       if (ucs < 0x10000) {
 	dst[count] = ucs;
@@ -455,9 +506,12 @@ unsigned fl_utf8toUtf16(const char* src, unsigned srclen,
   }
   /* we filled dst, measure the rest: */
   while (p < e) {
-    if (!(*p & 0x80)) p++;
-    else {
-      int len; unsigned ucs = fl_utf8decode(p,e,&len);
+    if (!(*p & 0x80)) {
+      unsigned n = ascii_run(p, e);
+      p += n; count += n;
+      continue;
+    } else {
+      int len; unsigned ucs = utf8_next(p,e,&len);
       p += len;
       if (ucs >= 0x10000) ++count;
     }
@@ -512,9 +566,18 @@ unsigned fl_utf8towc(const char* src, unsigned srclen,
       return count;
     }
     if (!(*p & 0x80)) { /* ascii */
+      if (p+1 < e && !(p[1] & 0x80)) {
+	unsigned i, n = ascii_run(p, e);
+	if (n > dstlen-1-count) n = dstlen-1-count;
+	if (n > 1) { /* copy all but the last one, which is done below */
+	  n--;
+	  for (i = 0; i < n; i++) dst[count+i] = (unsigned char)p[i];
+	  count += n; p += n;
+	}
+      }
       dst[count] = *p++;
     } else {
-      int len; unsigned ucs = fl_utf8decode(p,e,&len);
+      int len; unsigned ucs = utf8_next(p,e,&len);
       p += len;
       dst[count] = (wchar_t)ucs;
     }
@@ -522,9 +585,12 @@ unsigned fl_utf8towc(const char* src, unsigned srclen,
   }
   /* we filled dst, measure the rest: */
   while (p < e) {
-    if (!(*p & 0x80)) p++;
-    else {
-      int len; fl_utf8decode(p,e,&len);
+    if (!(*p & 0x80)) {
+      unsigned n = ascii_run(p, e);
+      p += n; count += n;
+      continue;
+    } else {
+      int len; utf8_next(p,e,&len);
       p += len;
     }
     ++count;
@@ -928,10 +994,12 @@ int fl_utf8test(const char* src, unsigned srclen) {
   const char* e = src+srclen;
   while (p < e) {
     if (*p & 0x80) {
-      int len; fl_utf8decode(p,e,&len);
+      int len; utf8_next(p,e,&len);
       if (len < 2) return 0;
       if (len > ret) ret = len;
       p += len;
+    } else if (p+1 < e && !(p[1] & 0x80)) {
+      p += ascii_run(p, e);
     } else {
       p++;
     }
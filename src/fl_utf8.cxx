@@ -81,24 +81,52 @@ extern "C" {
 
 #define NBC 0xFFFF + 1
 
-static int Toupper(int ucs) {
-  long i;
-  static unsigned short *table = NULL;
-
-  if (!table) {
-    table = (unsigned short*) malloc(
-	    sizeof(unsigned short) * (NBC));
-    for (i = 0; i < NBC; i++) {
-      table[i] = (unsigned short) i;
-    }
-    for (i = 0; i < NBC; i++) {
-      int l;
-      l = XUtf8Tolower(i);
-      if (l != i) table[l] = (unsigned short) i;
+// The case mapping of the first 64K characters is kept in two-level
+// tables, made from XUtf8Tolower() when they are first needed. Each
+// table has a page of 256 characters for each high byte, or NULL if the
+// page maps all characters to themselves.
+static unsigned short *lower_page[256];
+static unsigned short *upper_page[256];
+static char case_tables_ready;
+
+static void set_case(unsigned short **page, unsigned from, unsigned to) {
+  unsigned short *t = page[from >> 8];
+  if (!t) {
+    t = (unsigned short*) malloc(256 * sizeof(unsigned short));
+    for (unsigned i = 0; i < 256; i++) t[i] = (unsigned short) ((from & 0xff00) | i);
+    page[from >> 8] = t;
+  }
+  t[from & 0xff] = (unsigned short) to;
+}
+
+static void init_case_tables() {
+  for (int i = 0; i < NBC; i++) {
+    int l = XUtf8Tolower(i);
+    if (l != i && l >= 0 && l < NBC) {
+      set_case(lower_page, i, l);
+      set_case(upper_page, l, i);
     }
   }
+  case_tables_ready = 1;
+}
+
+static inline int ascii_lower(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static int Tolower(int ucs) {
+  if (ucs < 0x80 && ucs >= 0) return ascii_lower((unsigned char) ucs);
+  if (ucs >= NBC || ucs < 0) return XUtf8Tolower(ucs);
+  if (!case_tables_ready) init_case_tables();
+  unsigned short *t = lower_page[ucs >> 8];
+  return t ? t[ucs & 0xff] : ucs;
+}
+
+static int Toupper(int ucs) {
   if (ucs >= NBC || ucs < 0) return ucs;
-  return table[ucs];
+  if (!case_tables_ready) init_case_tables();
+  unsigned short *t = upper_page[ucs >> 8];
+  return t ? t[ucs & 0xff] : ucs;
 }
 
 /**
@@ -196,12 +224,23 @@ int fl_utf_strncasecmp(const char *s1, const char *s2, int n)
   for (i = 0; i < n; i++) {
     int l1, l2;
     unsigned int u1, u2;
-
-    if (*s1==0 && *s2==0) return 0; // all compared equal, return 0
+    unsigned char c1 = *(const unsigned char*)s1, c2 = *(const unsigned char*)s2;
+
+    if (!((c1 | c2) & 0x80)) { // both ASCII, no need to decode
+      if (c1 == c2) {
+        if (!c1) return 0; // all compared equal, return 0
+      } else {
+        int res = ascii_lower(c1) - ascii_lower(c2);
+        if (res) return res;
+      }
+      s1++;
+      s2++;
+      continue;
+    }
 
     u1 = fl_utf8decode(s1, 0, &l1);
     u2 = fl_utf8decode(s2, 0, &l2);
-    int res = XUtf8Tolower(u1) - XUtf8Tolower(u2);
+    int res = Tolower(u1) - Tolower(u2);
     if (res) return res;
     s1 += l1;
     s2 += l2;
@@ -228,7 +267,7 @@ int fl_utf_strcasecmp(const char *s1, const char *s2)
 */
 int fl_tolower(unsigned int ucs)
 {
-  return XUtf8Tolower(ucs);
+  return Tolower(ucs);
 }
 
 /**
@@ -253,7 +292,7 @@ int fl_utf_tolower(const unsigned char *str, int len, char *buf)
     unsigned int u1;
 
     u1 = fl_utf8decode((const char*)(str + i), end, &l1);
-    l2 = fl_utf8encode((unsigned int) XUtf8Tolower(u1), buf + l);
+    l2 = fl_utf8encode((unsigned int) Tolower(u1), buf + l);
     if (l1 < 1) {
       i += 1;
     } else {
@@ -268,6 +307,53 @@ int fl_utf_tolower(const unsigned char *str, int len, char *buf)
   return l;
 }
 
+/**
+  Makes a key for sorting strings without regard to case.
+
+  The key is the UTF-8 string \p src with all characters converted to
+  lower case, so comparing two keys with strcmp() gives the same order
+  as comparing the strings with fl_utf_strcasecmp(). When many strings
+  are sorted, making a key for each string once and sorting the keys
+  is much faster than calling fl_utf_strcasecmp() for each comparison.
+
+  Up to \p dstlen bytes are written to \p dst, including a null
+  terminator, but a character is never truncated. The return value is
+  the length of the whole key, not counting the null terminator. If it
+  is greater or equal to \p dstlen, the key was truncated and an array
+  of return+1 bytes is needed. If \p dstlen is zero, nothing is written.
+
+  \code
+  unsigned n = fl_utf_sortkey(name, 0, 0);
+  char *key = (char*)malloc(n + 1);
+  fl_utf_sortkey(name, key, n + 1);
+  \endcode
+*/
+unsigned fl_utf_sortkey(const char *src, char *dst, unsigned dstlen)
+{
+  unsigned count = 0, written = 0;
+  char buf[4];
+  while (*src) {
+    unsigned char c = *(const unsigned char*)src;
+    if (!(c & 0x80)) {
+      if (written == count && count + 1 < dstlen) dst[written++] = (char) ascii_lower(c);
+      count++;
+      src++;
+    } else {
+      int l1;
+      unsigned int u1 = fl_utf8decode(src, 0, &l1);
+      int l2 = fl_utf8encode((unsigned int) Tolower(u1), buf);
+      if (written == count && count + l2 < dstlen) {
+        memcpy(dst + written, buf, l2);
+        written += l2;
+      }
+      count += l2;
+      src += l1;
+    }
+  }
+  if (dstlen) dst[written] = 0;
+  return count;
+}
+
 /**
   Converts the string \p str to its upper case equivalent into buf.
   Warning: to be safe buf length must be at least 3 * len [for 16-bit Unicode]
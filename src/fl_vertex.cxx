@@ -35,6 +35,10 @@
 #include <FL/math.h>
 #include <stdlib.h>
 
+#ifdef USE_X11
+void fl_sync_gc(); // from fl_rect.cxx
+#endif
+
 void Fl_Graphics_Driver::push_matrix() {
   if (sptr==matrix_stack_size)
     Fl::error("fl_push_matrix(): matrix stack overflow.");
@@ -114,6 +118,7 @@ void Fl_Graphics_Driver::vertex(double x,double y) {
 
 void Fl_Graphics_Driver::end_points() {
 #if defined(USE_X11)
+  fl_sync_gc();
   if (n>1) XDrawPoints(fl_display, fl_window, fl_gc, p, n, 0);
 #elif defined(WIN32)
   for (int i=0; i<n; i++) SetPixel(fl_gc, p[i].x, p[i].y, fl_RGB());
@@ -136,6 +141,7 @@ void Fl_Graphics_Driver::end_line() {
     return;
   }
 #if defined(USE_X11)
+  fl_sync_gc();
   if (n>1) XDrawLines(fl_display, fl_window, fl_gc, p, n, 0);
 #elif defined(WIN32)
   if (n>1) Polyline(fl_gc, p, n);
@@ -169,6 +175,7 @@ void Fl_Graphics_Driver::end_polygon() {
     return;
   }
 #if defined(USE_X11)
+  fl_sync_gc();
   if (n>2) XFillPolygon(fl_display, fl_window, fl_gc, p, n, Convex, 0);
 #elif defined(WIN32)
   if (n>2) {
@@ -217,6 +224,7 @@ void Fl_Graphics_Driver::end_complex_polygon() {
     return;
   }
 #if defined(USE_X11)
+  fl_sync_gc();
   if (n>2) XFillPolygon(fl_display, fl_window, fl_gc, p, n, 0, 0);
 #elif defined(WIN32)
   if (n>2) {
@@ -252,6 +260,7 @@ void Fl_Graphics_Driver::circle(double x, double y,double r) {
   int h = (int)rint(yt+ry)-lly;
 
 #if defined(USE_X11)
+  fl_sync_gc();
   (what == POLYGON ? XFillArc : XDrawArc)
     (fl_display, fl_window, fl_gc, llx, lly, w, h, 0, 360*64);
 #elif defined(WIN32)
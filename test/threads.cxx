@@ -23,10 +23,15 @@
 #  include <FL/Fl_Double_Window.H>
 #  include <FL/Fl_Browser.H>
 #  include <FL/Fl_Value_Output.H>
+#  include <FL/Fl_Button.H>
+#  include <FL/Fl_Box.H>
 #  include <FL/fl_ask.H>
 #  include "threads.h"
 #  include <stdio.h>
 #  include <math.h>
+#  ifndef WIN32
+#    include <sys/time.h>
+#  endif // !WIN32
 
 Fl_Thread prime_thread;
 
@@ -109,6 +114,90 @@ extern "C" void* prime_func(void* p)
   return 0L;
 }
 
+// Stress test of Fl::awake(cb, data): several threads send a million
+// callbacks each as fast as they can, the main thread counts them...
+
+#  define STRESS_THREADS	4
+#  define STRESS_MESSAGES	1000000
+
+Fl_Button *stress_button;
+Fl_Box *stress_box;
+unsigned long stress_received;
+volatile int stress_failed[STRESS_THREADS], stress_done;
+double stress_start;
+long stress_last[STRESS_THREADS];
+int stress_order_errors;
+
+double stress_time() {
+#  ifdef WIN32
+  return GetTickCount() / 1000.0;
+#  else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+#  endif // WIN32
+}
+
+void stress_cb(void *p)
+{
+  // the callbacks of each thread must arrive in order:
+  long v = (long)p;
+  int t = (int)(v / (STRESS_MESSAGES + 1));
+  long n = v % (STRESS_MESSAGES + 1);
+  if (n != stress_last[t] + 1) stress_order_errors++;
+  stress_last[t] = n;
+  stress_received++;
+}
+
+extern "C" void* stress_func(void* p)
+{
+  long t = (long)p;
+  for (long n = 1; n <= STRESS_MESSAGES; n++)
+    if (Fl::awake(stress_cb, (void*)(t * (STRESS_MESSAGES + 1) + n)))
+      stress_failed[t]++;
+  Fl::lock();
+  stress_done++;
+  Fl::unlock();
+  return 0L;
+}
+
+void stress_update(void *)
+{
+  static char s[256];
+  int depth, max_depth, wakeups, failed = 0;
+  unsigned long handled;
+  Fl::awake_stats(&depth, &max_depth, &handled, &wakeups);
+  for (int i = 0; i < STRESS_THREADS; i++) failed += stress_failed[i];
+  double t = stress_time() - stress_start;
+  sprintf(s, "received %lu of %d\n%.2f million/s\n"
+          "failed %d, out of order %d\nqueue depth %d, max %d\nwakeups %d",
+          stress_received, STRESS_THREADS * STRESS_MESSAGES,
+          t > 0.0 ? stress_received / t / 1e6 : 0.0,
+          failed, stress_order_errors, depth, max_depth, wakeups);
+  stress_box->label(s);
+  if (stress_done < STRESS_THREADS || stress_received < (unsigned long)(STRESS_THREADS * STRESS_MESSAGES - failed))
+    Fl::repeat_timeout(0.25, stress_update);
+  else
+    stress_button->activate();
+}
+
+void stress_button_cb(Fl_Widget *, void *)
+{
+  stress_button->deactivate();
+  stress_received = 0;
+  stress_order_errors = 0;
+  stress_done = 0;
+  for (int i = 0; i < STRESS_THREADS; i++) {
+    stress_failed[i] = 0;
+    stress_last[i] = 0;
+  }
+  stress_start = stress_time();
+  Fl_Thread thread;
+  for (long i = 0; i < STRESS_THREADS; i++)
+    fl_create_thread(thread, stress_func, (void*)i);
+  Fl::add_timeout(0.25, stress_update);
+}
+
 int main(int argc, char **argv)
 {
   Fl_Double_Window* w = new Fl_Double_Window(200, 200, "Single Thread");
@@ -124,6 +213,15 @@ int main(int argc, char **argv)
   w->end();
   w->show();
   
+  w = new Fl_Double_Window(200, 200, "Awake Stress Test");
+  stress_button = new Fl_Button(10, 10, 180, 25, "Send 4 x 1000000");
+  stress_button->callback(stress_button_cb);
+  stress_box = new Fl_Box(10, 45, 180, 145);
+  stress_box->align(FL_ALIGN_INSIDE|FL_ALIGN_TOP_LEFT);
+  stress_box->labelsize(12);
+  w->end();
+  w->show();
+
   browser1->add("Prime numbers:");
   browser2->add("Prime numbers:");
 
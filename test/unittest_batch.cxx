@@ -0,0 +1,94 @@
+//
+// "$Id$"
+//
+// Unit tests for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2016 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+#include <FL/Fl_Box.H>
+#include <FL/fl_draw.H>
+#include <FL/x.H>
+#include <stdio.h>
+
+//
+//------- test and benchmark batched drawing of lines, rectangles and points ----------
+//
+class BatchTest : public Fl_Box {
+public:
+  static Fl_Widget *create() {
+    return new BatchTest(TESTAREA_X, TESTAREA_Y, TESTAREA_W, TESTAREA_H);
+  }
+  BatchTest(int x, int y, int w, int h) : Fl_Box(x, y, w, h) {
+    label("testing fl_begin_batch() and fl_end_batch()\n"
+	  "The left chart is drawn with single calls, the right chart with "
+	  "batched calls. Both charts should look the same.");
+    align(FL_ALIGN_INSIDE|FL_ALIGN_BOTTOM|FL_ALIGN_LEFT|FL_ALIGN_WRAP);
+    box(FL_BORDER_BOX);
+  }
+  // draws 5000 bars, 5000 line segments and 5000 points
+  void chart(int a, int b, int cw, int ch) {
+    fl_color(FL_WHITE); fl_rectf(a, b, cw, ch);
+    int i;
+    for (i = 0; i < 5000; i++) {
+      int bx = a + 1 + (i * 7) % (cw - 2), bh = 1 + (i * 13) % (ch - 2);
+      fl_color(i < 2500 ? FL_DARK_BLUE : FL_DARK_GREEN);
+      fl_rectf(bx, b + ch - 1 - bh, 2, bh);
+    }
+    fl_color(FL_RED);
+    for (i = 0; i < 5000; i++) {
+      int x1 = a + 1 + (i * 3) % (cw - 2), y1 = b + 1 + (i * 11) % (ch - 2);
+      fl_line(x1, y1, x1 + 3, y1 + (i % 5) - 2);
+    }
+    for (i = 0; i < 2500; i++) {
+      fl_xyline(a + 1 + (i * 17) % (cw - 8), b + 1 + (i * 5) % (ch - 2), a + 5 + (i * 17) % (cw - 8));
+      fl_yxline(a + 1 + (i * 5) % (cw - 2), b + 1 + (i * 17) % (ch - 8), b + 5 + (i * 17) % (ch - 8));
+    }
+    fl_color(FL_BLACK);
+    for (i = 0; i < 5000; i++)
+      fl_point(a + 1 + (i * 29) % (cw - 2), b + 1 + (i * 31) % (ch - 2));
+    fl_color(FL_BLACK); fl_rect(a, b, cw, ch);
+  }
+  void draw() {
+    Fl_Box::draw();
+    int a = x()+10, b = y()+10, cw = (w()-30)/2, ch = h()-100;
+    char buf[100];
+    unsigned long r0 = 0, r1 = 0, r2 = 0;
+#if !defined(WIN32) && !defined(__APPLE__)
+    r0 = NextRequest(fl_display);
+#endif
+    chart(a, b, cw, ch);
+#if !defined(WIN32) && !defined(__APPLE__)
+    r1 = NextRequest(fl_display);
+#endif
+    fl_begin_batch();
+    chart(a+cw+10, b, cw, ch);
+    fl_end_batch();
+#if !defined(WIN32) && !defined(__APPLE__)
+    r2 = NextRequest(fl_display);
+#endif
+    if (r2 > r1) {
+      fl_color(FL_BLACK); fl_font(FL_HELVETICA, 12);
+      sprintf(buf, "%lu X requests", r1 - r0);
+      fl_draw(buf, a, b+ch+15);
+      sprintf(buf, "%lu X requests", r2 - r1);
+      fl_draw(buf, a+cw+10, b+ch+15);
+    }
+  }
+};
+
+UnitTest batch("batched drawing", BatchTest::create);
+
+//
+// End of "$Id$"
+//
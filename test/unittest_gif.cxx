@@ -0,0 +1,111 @@
+//
+// "$Id$"
+//
+// Unit tests for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2016 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+#include <FL/Fl_Box.H>
+#include <FL/Fl_GIF_Image.H>
+#include <FL/fl_draw.H>
+#include <FL/filename.H>
+#include <FL/fl_utf8.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+//------- test decoding of GIF frames outside of the logical screen ----------
+//
+class GifTest : public Fl_Box {
+  enum { CASES = 4 };
+  int x_[CASES];		// x position of the first frame
+  int ok_[CASES];		// result of each case
+public:
+  static Fl_Widget *create() {
+    return new GifTest(TESTAREA_X, TESTAREA_Y, TESTAREA_W, TESTAREA_H);
+  }
+  GifTest(int x, int y, int w, int h) : Fl_Box(x, y, w, h) {
+    label("testing Fl_Anim_GIF_Image with frames outside of the logical screen\n"
+	  "Each 4x4 GIF has a 2x2 red frame at the given x position, which is\n"
+	  "disposed to the background, and a second frame in the top left corner.\n"
+	  "Broken files must be loaded without crashing.");
+    align(FL_ALIGN_INSIDE|FL_ALIGN_BOTTOM|FL_ALIGN_LEFT|FL_ALIGN_WRAP);
+    box(FL_BORDER_BOX);
+    x_[0] = 0; x_[1] = 3; x_[2] = 10; x_[3] = 0xffff;
+    for (int i = 0; i < CASES; i++) ok_[i] = run(x_[i]);
+  }
+  // writes a GIF with the first frame at fx, 0 and checks the decoded frames
+  static int run(int fx) {
+    static const uchar head[] = {
+      'G','I','F','8','9','a', 4,0, 4,0, 0x80, 0, 0,	// 4x4, 2 colors
+      0,0,0, 255,0,0					// black, red
+    };
+    static const uchar dispose[] = { 0x21, 0xf9, 4, 2 << 2, 0, 0, 0, 0 };
+    static const uchar pixels[] = { 2, 4, 0x0c, 0xc3, 0x30, 0x05, 0 }; // 4 x red
+    char name[FL_PATH_MAX];
+    const char *dir = getenv("TMPDIR");
+#ifdef WIN32
+    if (!dir) dir = getenv("TEMP");
+#endif
+    if (!dir) dir = "/tmp";
+    snprintf(name, sizeof(name), "%s/unittest_gif.gif", dir);
+    FILE *f = fopen(name, "wb");
+    if (!f) return -1;
+    fwrite(head, 1, sizeof(head), f);
+    fwrite(dispose, 1, sizeof(dispose), f);
+    uchar desc[] = { 0x2c, (uchar)fx, (uchar)(fx >> 8), 0, 0, 2, 0, 2, 0, 0 };
+    fwrite(desc, 1, sizeof(desc), f);
+    fwrite(pixels, 1, sizeof(pixels), f);
+    desc[1] = desc[2] = 0;
+    fwrite(desc, 1, sizeof(desc), f);
+    fwrite(pixels, 1, sizeof(pixels), f);
+    fputc(0x3b, f);
+    fclose(f);
+
+    Fl_Anim_GIF_Image img(name);
+    fl_unlink(name);
+    if (img.frames() != 2) return 0;
+    // the first frame must be red where it is inside of the screen:
+    const uchar *p = img.frame_data(0);
+    for (int y = 0; y < 4; y++) for (int x = 0; x < 4; x++, p += 4) {
+      int red = (x >= fx && x < fx + 2 && y < 2);
+      if (p[0] != (red ? 255 : 0) || p[3] != (red ? 255 : 0)) return 0;
+    }
+    // the second frame is drawn after the first was disposed of:
+    p = img.frame_data(1);
+    for (int y = 0; y < 4; y++) for (int x = 0; x < 4; x++, p += 4) {
+      int red = (x < 2 && y < 2);
+      if (p[0] != (red ? 255 : 0)) return 0;
+    }
+    return 1;
+  }
+  void draw() {
+    Fl_Box::draw();
+    char buf[100];
+    fl_font(FL_HELVETICA, 14);
+    for (int i = 0; i < CASES; i++) {
+      sprintf(buf, "first frame at x = %d: %s", x_[i],
+	      ok_[i] > 0 ? "passed" : ok_[i] < 0 ? "can't write file" : "FAILED");
+      fl_color(ok_[i] > 0 ? FL_BLACK : FL_RED);
+      fl_draw(buf, x() + 20, y() + 30 + 20 * i);
+    }
+  }
+};
+
+UnitTest gif("GIF frame clipping", GifTest::create);
+
+//
+// End of "$Id$"
+//
@@ -0,0 +1,130 @@
+//
+// "$Id$"
+//
+// Unit tests for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2016 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Indexed_Image.H>
+#include <FL/fl_draw.H>
+#include <stdio.h>
+#include <string.h>
+
+//
+//------- test conversion of XPM data to Fl_Indexed_Image ----------
+//
+
+static const char * const indexed_xpm1[] = {	// 1 character per pixel
+  "3 2 2 1",
+  "a c #ff0000",
+  "b c None",
+  "aba",
+  "bab"
+};
+
+static const char * const indexed_xpm2[] = {	// 2 characters per pixel
+  "2 2 3 2",
+  "aa c #0000ff",
+  "bb c #00ff00",
+  "cc c #ff0000",
+  "ccaa",
+  "bbcc"
+};
+
+static const char * const indexed_xpm_compressed[] = {	// FLTK colormap
+  "2 1 -2 1",
+  "a\377\000\000b\000\000\377",
+  "ba"
+};
+
+static const char * const indexed_xpm_cpp0[]  = { "2 1 1 0", "a c #ff0000", "aa" };
+static const char * const indexed_xpm_cpp3[]  = { "2 1 1 3", "aaa c #ff0000", "aaaaaa" };
+static const char * const indexed_xpm_cppn[]  = { "2 1 1 -2", "a c #ff0000", "aa" };
+static const char * const indexed_xpm_comp2[] = { "2 1 -1 2", "aa\377\000\000", "aaaa" };
+static const char * const indexed_xpm_bad[]   = { "two by one", "a c #ff0000", "aa" };
+
+class IndexedTest : public Fl_Box {
+  enum { CASES = 8 };
+  const char *name_[CASES];	// description of each case
+  int ok_[CASES];		// result of each case
+public:
+  static Fl_Widget *create() {
+    return new IndexedTest(TESTAREA_X, TESTAREA_Y, TESTAREA_W, TESTAREA_H);
+  }
+  IndexedTest(int x, int y, int w, int h) : Fl_Box(x, y, w, h) {
+    label("testing Fl_Indexed_Image(const char * const *xpm)\n"
+	  "Valid XPM data must give the expected palette and indices,\n"
+	  "malformed XPM data must be rejected with ERR_FORMAT.");
+    align(FL_ALIGN_INSIDE|FL_ALIGN_BOTTOM|FL_ALIGN_LEFT|FL_ALIGN_WRAP);
+    box(FL_BORDER_BOX);
+    int i = 0;
+    name_[i] = "1 character per pixel";     ok_[i++] = test_cpp1();
+    name_[i] = "2 characters per pixel";    ok_[i++] = test_cpp2();
+    name_[i] = "compressed colormap";       ok_[i++] = test_compressed();
+    name_[i] = "0 characters per pixel";    ok_[i++] = rejected(indexed_xpm_cpp0);
+    name_[i] = "3 characters per pixel";    ok_[i++] = rejected(indexed_xpm_cpp3);
+    name_[i] = "-2 characters per pixel";   ok_[i++] = rejected(indexed_xpm_cppn);
+    name_[i] = "compressed, 2 characters";  ok_[i++] = rejected(indexed_xpm_comp2);
+    name_[i] = "broken header";             ok_[i++] = rejected(indexed_xpm_bad);
+  }
+  // checks the RGBA palette entry of an index
+  static int color(const Fl_Indexed_Image &img, int index, unsigned rgba) {
+    const uchar *p = img.palette() + 4 * index;
+    return ((unsigned)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]) == rgba;
+  }
+  static int test_cpp1() {
+    Fl_Indexed_Image img(indexed_xpm1);
+    if (img.fail() || img.w() != 3 || img.h() != 2 || img.index_size() != 1 ||
+        img.d() != 4) return 0;
+    if (memcmp(img.indices(), "ababab", 6)) return 0;
+    return color(img, 'a', 0xff0000ff) && (img.palette()[4 * 'b' + 3] == 0);
+  }
+  static int test_cpp2() {
+    Fl_Indexed_Image img(indexed_xpm2);
+    if (img.fail() || img.w() != 2 || img.h() != 2 || img.index_size() != 1 ||
+        img.ncolors() != 3 || img.d() != 3) return 0;
+    static const uchar indices[] = { 2, 0, 1, 2 };
+    if (memcmp(img.indices(), indices, 4)) return 0;
+    return color(img, 0, 0x0000ffff) && color(img, 1, 0x00ff00ff) &&
+           color(img, 2, 0xff0000ff);
+  }
+  static int test_compressed() {
+    Fl_Indexed_Image img(indexed_xpm_compressed);
+    if (img.fail() || img.w() != 2 || img.h() != 1 || img.index_size() != 1)
+      return 0;
+    if (memcmp(img.indices(), "ba", 2)) return 0;
+    return color(img, 'a', 0xff0000ff) && color(img, 'b', 0x0000ffff);
+  }
+  static int rejected(const char * const *xpm) {
+    Fl_Indexed_Image img(xpm);
+    return img.fail() == Fl_Image::ERR_FORMAT && !img.indices();
+  }
+  void draw() {
+    Fl_Box::draw();
+    char buf[100];
+    fl_font(FL_HELVETICA, 14);
+    for (int i = 0; i < CASES; i++) {
+      sprintf(buf, "%s: %s", name_[i], ok_[i] ? "passed" : "FAILED");
+      fl_color(ok_[i] ? FL_BLACK : FL_RED);
+      fl_draw(buf, x() + 20, y() + 30 + 20 * i);
+    }
+  }
+};
+
+UnitTest indexed("Indexed images", IndexedTest::create);
+
+//
+// End of "$Id$".
+//
@@ -146,10 +146,13 @@ public:
 #include "unittest_points.cxx"
 #include "unittest_lines.cxx"
 #include "unittest_rects.cxx"
+#include "unittest_batch.cxx"
 #include "unittest_circles.cxx"
 #include "unittest_text.cxx"
 #include "unittest_symbol.cxx"
 #include "unittest_images.cxx"
+#include "unittest_gif.cxx"
+#include "unittest_indexed.cxx"
 #include "unittest_viewport.cxx"
 #include "unittest_scrollbarsize.cxx"
 #include "unittest_schemes.cxx"